@@ -0,0 +1,197 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Compares plain books with books created with CBOOK_INTERN, when writing the given number of words picked
+ * from vocabularies of growing sizes, like the property names and values of a config file. Reports the time
+ * per write, the number of characters each book ends up holding, and the time per comparison of two random
+ * words, done with strcmp() in the plain book and with cbook_word_id() in the interned one.
+ *
+ * usage : book_intern [words]
+ */
+
+#include <cassette/cobj.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define COMPARISONS 10000000
+#define WORD_LEN    32
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static double compare (const cbook *, size_t *, bool);
+static double elapsed (struct timespec);
+static double fill    (cbook *);
+static void   run     (size_t);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static char *chars    = NULL;
+static size_t n_words = 10000000;
+
+/************************************************************************************************************/
+/* MAIN *****************************************************************************************************/
+/************************************************************************************************************/
+
+int
+main(int argc, char **argv)
+{
+	/* Setup */
+
+	if (argc > 1)
+	{
+		n_words = strtoul(argv[1], NULL, 10);
+	}
+
+	if (n_words == 0 || !(chars = malloc(n_words * WORD_LEN)))
+	{
+		return 1;
+	}
+
+	/* Operations */
+
+	printf("%10s %12s %12s %14s %14s %12s %12s\n",
+		"vocabulary", "plain w ns", "intern w ns", "plain chars", "intern chars", "strcmp ns", "id ns");
+
+	for (size_t n = 10; n <= 1000000; n *= 10)
+	{
+		run(n);
+	}
+
+	/* End */
+
+	free(chars);
+
+	return 0;
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static double
+compare(const cbook *book, size_t *n_equal, bool by_id)
+{
+	struct timespec t;
+	size_t i;
+	size_t j;
+	size_t r = 1;
+
+	*n_equal = 0;
+
+	/* indexes come from a xorshift generator, so that rand() doesn't weigh on the timings */
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t k = 0; k < COMPARISONS; k++)
+	{
+		r ^= r << 13;
+		r ^= r >> 7;
+		r ^= r << 17;
+		i  = r % n_words;
+		j  = (r >> 32) % n_words;
+		*n_equal += by_id
+			? cbook_word_id(book, i) == cbook_word_id(book, j)
+			: strcmp(cbook_word(book, i), cbook_word(book, j)) == 0;
+	}
+
+	return elapsed(t) * 1e9 / COMPARISONS;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static double
+elapsed(struct timespec t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static double
+fill(cbook *book)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < n_words; i++)
+	{
+		cbook_write(book, chars + i * WORD_LEN);
+	}
+
+	return elapsed(t) * 1e9 / n_words;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+run(size_t n)
+{
+	cbook *plain;
+	cbook *intern;
+	double t_plain;
+	double t_intern;
+	double t_strcmp;
+	double t_id;
+	size_t n_strcmp;
+	size_t n_id;
+
+	for (size_t i = 0; i < n_words; i++)
+	{
+		snprintf(chars + i * WORD_LEN, WORD_LEN, "property-name-%zu", (size_t)rand() % n);
+	}
+
+	plain    = cbook_create();
+	intern   = cbook_create_with_flags(CBOOK_INTERN);
+	t_plain  = fill(plain);
+	t_intern = fill(intern);
+	t_strcmp = compare(plain,  &n_strcmp, false);
+	t_id     = compare(intern, &n_id,     true);
+
+	printf("%10zu %12.1f %12.1f %14zu %14zu %12.1f %12.1f\n",
+		n,
+		t_plain,
+		t_intern,
+		cbook_length(plain),
+		cbook_length(intern),
+		t_strcmp,
+		t_id);
+
+	if (cbook_error(plain) || cbook_error(intern) || n_strcmp != n_id)
+	{
+		printf("Book errored during operation\n");
+	}
+
+	cbook_destroy(plain);
+	cbook_destroy(intern);
+}
@@ -0,0 +1,165 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Compares books storing word offsets on the width of size_t with books created with CBOOK_COMPACT_OFFSETS,
+ * on books of growing sizes from 1M short tokens up to the given maximum, split in groups of 8 words. Reports
+ * the time per write, the time per random access to a word of a group, and the time per sequential pass over
+ * all words, whose offsets are read one cache line after the other.
+ *
+ * usage : book_offsets [max words]
+ */
+
+#include <cassette/cobj.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define LOOKUPS  10000000
+#define WORD_LEN 16
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static double elapsed (struct timespec);
+static void   run     (size_t, unsigned int, double *, double *, double *);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static size_t n_max = 64000000;
+
+/************************************************************************************************************/
+/* MAIN *****************************************************************************************************/
+/************************************************************************************************************/
+
+int
+main(int argc, char **argv)
+{
+	double t_write[2];
+	double t_random[2];
+	double t_scan[2];
+
+	/* Setup */
+
+	if (argc > 1)
+	{
+		n_max = strtoul(argv[1], NULL, 10);
+	}
+
+	/* Operations */
+
+	printf("%12s %10s %10s %10s %10s %10s %10s\n",
+		"words", "w ns", "compact", "random ns", "compact", "scan ns", "compact");
+
+	for (size_t n = 1000000; n <= n_max; n *= 4)
+	{
+		run(n, 0,                     t_write,     t_random,     t_scan);
+		run(n, CBOOK_COMPACT_OFFSETS, t_write + 1, t_random + 1, t_scan + 1);
+
+		printf("%12zu %10.1f %10.1f %10.1f %10.1f %10.2f %10.2f\n",
+			n,
+			t_write[0],
+			t_write[1],
+			t_random[0],
+			t_random[1],
+			t_scan[0],
+			t_scan[1]);
+	}
+
+	/* End */
+
+	return 0;
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static double
+elapsed(struct timespec t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+run(size_t n, unsigned int flags, double *t_write, double *t_random, double *t_scan)
+{
+	struct timespec t;
+	cbook *book;
+	char str[WORD_LEN];
+	size_t n_groups;
+	size_t sum = 0;
+	size_t r   = 1;
+
+	book = cbook_create_with_flags(flags);
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < n; i++)
+	{
+		if (i % 8 == 0)
+		{
+			cbook_prepare_new_group(book);
+		}
+		snprintf(str, WORD_LEN, "t%zu", i % 1000);
+		cbook_write(book, str);
+	}
+	*t_write = elapsed(t) * 1e9 / n;
+
+	/* indexes come from a xorshift generator, so that rand() doesn't weigh on the timings */
+
+	n_groups = cbook_groups_number(book);
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		r   ^= r << 13;
+		r   ^= r >> 7;
+		r   ^= r << 17;
+		sum += *cbook_word_in_group(book, r % n_groups, (r >> 32) % 8);
+	}
+	*t_random = elapsed(t) * 1e9 / LOOKUPS;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < n; i++)
+	{
+		sum += *cbook_word(book, i);
+	}
+	*t_scan = elapsed(t) * 1e9 / n;
+
+	if (cbook_error(book) || sum == 0)
+	{
+		printf("Book errored during operation\n");
+	}
+
+	cbook_destroy(book);
+}
@@ -0,0 +1,182 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Compares the time per lookup of successive cdict_find() calls against cdict_find_batch() on dictionaries
+ * of growing sizes, from 1K entries up to the given maximum (100M entries need several GB of memory).
+ *
+ * usage : dict_batch [max entries] [batch size]
+ */
+
+#include <cassette/cobj.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define LOOKUPS 1000000
+#define KEY_LEN 32
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static double elapsed (struct timespec);
+static void   run     (size_t);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static char *chars       = NULL;
+static const char **keys = NULL;
+static size_t *groups    = NULL;
+static size_t *values    = NULL;
+static size_t n_max      = 10000000;
+static size_t n_batch    = 256;
+
+/************************************************************************************************************/
+/* MAIN *****************************************************************************************************/
+/************************************************************************************************************/
+
+int
+main(int argc, char **argv)
+{
+	/* Setup */
+
+	if (argc > 1)
+	{
+		n_max = strtoul(argv[1], NULL, 10);
+	}
+
+	if (argc > 2)
+	{
+		n_batch = strtoul(argv[2], NULL, 10);
+	}
+
+	chars  = malloc(LOOKUPS * KEY_LEN);
+	keys   = malloc(LOOKUPS * sizeof(char*));
+	groups = calloc(LOOKUPS, sizeof(size_t));
+	values = malloc(LOOKUPS * sizeof(size_t));
+
+	if (!chars || !keys || !groups || !values || n_batch == 0)
+	{
+		return 1;
+	}
+
+	/* Operations */
+
+	printf("%12s %14s %14s %10s\n", "entries", "find ns", "batch ns", "speedup");
+
+	for (size_t n = 1000; n <= n_max; n *= 10)
+	{
+		run(n);
+	}
+
+	/* End */
+
+	free(chars);
+	free(keys);
+	free(groups);
+	free(values);
+
+	return 0;
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static double
+elapsed(struct timespec t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+run(size_t n)
+{
+	struct timespec t;
+	cdict *dict;
+	char str[KEY_LEN];
+	double t_find;
+	double t_batch;
+	size_t hits = 0;
+	size_t v;
+
+	dict = cdict_create();
+	cdict_prealloc(dict, n);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		snprintf(str, KEY_LEN, "key-%zu", i);
+		cdict_write(dict, str, 0, i);
+	}
+
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		keys[i] = chars + i * KEY_LEN;
+		snprintf(chars + i * KEY_LEN, KEY_LEN, "key-%zu", ((size_t)rand() * RAND_MAX + rand()) % n);
+	}
+
+	/* one by one */
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		if (cdict_find(dict, keys[i], 0, &v))
+		{
+			hits += v & 1;
+		}
+	}
+	t_find = elapsed(t);
+
+	/* batched */
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < LOOKUPS; i += n_batch)
+	{
+		cdict_find_batch(dict, keys + i, groups + i, LOOKUPS - i < n_batch ? LOOKUPS - i : n_batch,
+			values + i, NULL);
+	}
+	t_batch = elapsed(t);
+
+	printf("%12zu %14.1f %14.1f %9.2fx\n",
+		n,
+		t_find  * 1e9 / LOOKUPS,
+		t_batch * 1e9 / LOOKUPS,
+		t_find / t_batch);
+
+	if (cdict_error(dict) || hits > LOOKUPS)
+	{
+		printf("Dictionary errored during operation\n");
+	}
+
+	cdict_destroy(dict);
+}
@@ -0,0 +1,232 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Compares the time per lookup of a frozen dictionary with and without a Bloom filter attached, when 90% of
+ * the looked up keys are missing, on dictionaries of growing sizes from 1K entries up to the given maximum.
+ * The image file is dropped from the page cache before each pass, as if it was only read from the disk on
+ * demand, while the filter stays in memory. Also reports how long filling the filter from the dictionary
+ * took, its size per entry and its measured false positive rate.
+ *
+ * usage : dict_bloom [max entries] [bits per key]
+ */
+
+#include <cassette/cobj.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define LOOKUPS 1000000
+#define KEY_LEN 32
+#define PATH    "dict_bloom.bin"
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static double elapsed   (struct timespec);
+static double look_up   (const cdict *, size_t *);
+static cdict *open_cold (void);
+static void   run       (size_t);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static char *chars  = NULL;
+static size_t n_max = 10000000;
+static size_t bits  = 10;
+
+/************************************************************************************************************/
+/* MAIN *****************************************************************************************************/
+/************************************************************************************************************/
+
+int
+main(int argc, char **argv)
+{
+	/* Setup */
+
+	if (argc > 1)
+	{
+		n_max = strtoul(argv[1], NULL, 10);
+	}
+
+	if (argc > 2)
+	{
+		bits = strtoul(argv[2], NULL, 10);
+	}
+
+	if (!(chars = malloc(LOOKUPS * KEY_LEN)))
+	{
+		return 1;
+	}
+
+	/* Operations */
+
+	printf("%12s %12s %12s %10s %12s %12s %12s\n",
+		"entries", "plain ns", "bloom ns", "speedup", "fill ms", "bloom B/e", "false pos %");
+
+	for (size_t n = 1000; n <= n_max; n *= 10)
+	{
+		run(n);
+	}
+
+	/* End */
+
+	remove(PATH);
+	free(chars);
+
+	return 0;
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static double
+elapsed(struct timespec t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static double
+look_up(const cdict *dict, size_t *hits)
+{
+	struct timespec t;
+	size_t v;
+
+	*hits = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		*hits += cdict_find(dict, chars + i * KEY_LEN, 0, &v);
+	}
+
+	return elapsed(t) * 1e9 / LOOKUPS;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static cdict *
+open_cold(void)
+{
+	int fd;
+
+	/* pages still mapped by a process are not dropped, so the previous dictionary must be destroyed first */
+
+	if ((fd = open(PATH, O_RDONLY)) >= 0)
+	{
+		fdatasync(fd);
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+
+	return cdict_open_frozen(PATH);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+run(size_t n)
+{
+	struct timespec t;
+	cdict *dict;
+	cbloom *bloom;
+	char str[KEY_LEN];
+	double t_plain;
+	double t_bloom;
+	double t_fill;
+	size_t hits;
+	size_t bytes;
+	size_t k;
+	size_t n_fp = 0;
+
+	dict = cdict_create();
+	cdict_prealloc(dict, n);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		snprintf(str, KEY_LEN, "key-%zu", i);
+		cdict_write(dict, str, 0, i);
+	}
+
+	cdict_freeze_to_file(dict, PATH);
+	cdict_destroy(dict);
+
+	/* 1 lookup in 10 hits an existing key */
+
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		k = ((size_t)rand() * RAND_MAX + rand()) % n;
+		snprintf(chars + i * KEY_LEN, KEY_LEN, i % 10 ? "nil-%zu" : "key-%zu", k);
+	}
+
+	dict    = open_cold();
+	t_plain = look_up(dict, &hits);
+	bloom   = cbloom_create(n, bits);
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	cdict_fill_bloom(dict, bloom);
+	t_fill = elapsed(t);
+
+	cdict_destroy(dict);
+
+	dict = open_cold();
+	cdict_set_bloom(dict, bloom);
+	t_bloom = look_up(dict, &hits);
+
+	for (size_t i = 1; i < LOOKUPS; i += 10)
+	{
+		n_fp += cbloom_test(bloom, cdict_hash(dict, chars + i * KEY_LEN, strlen(chars + i * KEY_LEN), 0).hash);
+	}
+
+	bytes = cbloom_bytes(bloom);
+
+	printf("%12zu %12.1f %12.1f %9.2fx %12.1f %12.1f %12.2f\n",
+		n,
+		t_plain,
+		t_bloom,
+		t_plain / t_bloom,
+		t_fill * 1e3,
+		(double)bytes / n,
+		100.0 * n_fp / (LOOKUPS / 10));
+
+	if (cdict_error(dict) || cbloom_error(bloom) || hits != LOOKUPS / 10)
+	{
+		printf("Dictionary errored during operation\n");
+	}
+
+	cdict_destroy(dict);
+	cbloom_destroy(bloom);
+}
@@ -0,0 +1,173 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Compares the time taken to load a dictionary with successive cdict_write() calls against cdict_build()
+ * with a growing number of threads, from 1 up to the given maximum.
+ *
+ * usage : dict_build [entries] [max threads]
+ */
+
+#include <cassette/cobj.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define KEY_LEN 32
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static double elapsed (struct timespec);
+static double run     (size_t);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static char *chars       = NULL;
+static const char **keys = NULL;
+static size_t *groups    = NULL;
+static size_t *values    = NULL;
+static size_t n_entries  = 10000000;
+static size_t n_threads  = 32;
+
+/************************************************************************************************************/
+/* MAIN *****************************************************************************************************/
+/************************************************************************************************************/
+
+int
+main(int argc, char **argv)
+{
+	double t_write;
+	double t_build;
+
+	/* Setup */
+
+	if (argc > 1)
+	{
+		n_entries = strtoul(argv[1], NULL, 10);
+	}
+
+	if (argc > 2)
+	{
+		n_threads = strtoul(argv[2], NULL, 10);
+	}
+
+	chars  = malloc(n_entries * KEY_LEN);
+	keys   = malloc(n_entries * sizeof(char*));
+	groups = calloc(n_entries, sizeof(size_t));
+	values = malloc(n_entries * sizeof(size_t));
+
+	if (!chars || !keys || !groups || !values || n_entries == 0)
+	{
+		return 1;
+	}
+
+	for (size_t i = 0; i < n_entries; i++)
+	{
+		keys[i]   = chars + i * KEY_LEN;
+		values[i] = i;
+		snprintf(chars + i * KEY_LEN, KEY_LEN, "key-%zu", i);
+	}
+
+	/* Operations */
+
+	t_write = run(0);
+
+	printf("%8s %12s %14s %10s\n", "threads", "time ms", "M keys/s", "speedup");
+	printf("%8s %12.1f %14.2f %10s\n", "writes", t_write * 1e3, n_entries / t_write / 1e6, "-");
+
+	for (size_t n = 1; n <= n_threads; n *= 2)
+	{
+		t_build = run(n);
+
+		printf("%8zu %12.1f %14.2f %9.2fx\n",
+			n,
+			t_build * 1e3,
+			n_entries / t_build / 1e6,
+			t_write / t_build);
+	}
+
+	/* End */
+
+	free(chars);
+	free(keys);
+	free(groups);
+	free(values);
+
+	return 0;
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static double
+elapsed(struct timespec t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static double
+run(size_t n)
+{
+	struct timespec t;
+	cdict *dict;
+	double t_run;
+
+	/* 0 threads stands for successive writes */
+
+	dict = cdict_create();
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	if (n > 0)
+	{
+		cdict_build(dict, keys, groups, values, n_entries, n);
+	}
+	else
+	{
+		for (size_t i = 0; i < n_entries; i++)
+		{
+			cdict_write(dict, keys[i], groups[i], values[i]);
+		}
+	}
+	t_run = elapsed(t);
+
+	if (cdict_error(dict) || cdict_load(dict) != n_entries)
+	{
+		printf("Dictionary errored during operation\n");
+	}
+
+	cdict_destroy(dict);
+
+	return t_run;
+}
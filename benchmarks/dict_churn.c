@@ -0,0 +1,218 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Keeps a fixed number of keys in a dictionary while erasing a random key and inserting a new one at each
+ * cycle, then reports after every round of cycles the average and maximum probe lengths of successful and
+ * unsuccessful lookups.
+ *
+ * usage : dict_churn [keys] [rounds] [max load factor]
+ */
+
+#include <cassette/cobj.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define CYCLES  1000000
+#define SAMPLES 100000
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static double elapsed (struct timespec);
+static void   key     (char [static 32], size_t);
+static void   run     (enum cdict_probing, const char *);
+static void   sample  (size_t, size_t, double *, size_t *);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static cdict *dict     = CDICT_PLACEHOLDER;
+static size_t *ids     = NULL;
+static size_t n_keys   = 800000;
+static size_t n_rounds = 4;
+static double max_load = 0.8;
+
+/************************************************************************************************************/
+/* MAIN *****************************************************************************************************/
+/************************************************************************************************************/
+
+int
+main(int argc, char **argv)
+{
+	/* Setup */
+
+	if (argc > 1)
+	{
+		n_keys = strtoul(argv[1], NULL, 10);
+	}
+
+	if (argc > 2)
+	{
+		n_rounds = strtoul(argv[2], NULL, 10);
+	}
+
+	if (argc > 3)
+	{
+		max_load = strtod(argv[3], NULL);
+	}
+
+	if (n_keys == 0 || !(ids = malloc(n_keys * sizeof(size_t))))
+	{
+		return 1;
+	}
+
+	/* Operations */
+
+	run(CDICT_PROBE_GROUPS,     "groups");
+	run(CDICT_PROBE_ROBIN_HOOD, "robin hood");
+
+	/* End */
+
+	free(ids);
+
+	return 0;
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static double
+elapsed(struct timespec t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+key(char str[static 32], size_t id)
+{
+	snprintf(str, 32, "key-%zu", id);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+run(enum cdict_probing probing, const char *name)
+{
+	struct timespec t;
+	char str[32];
+	double mean_hit;
+	double mean_miss;
+	size_t max_hit;
+	size_t max_miss;
+	size_t next_id = 0;
+	size_t j;
+
+	dict = cdict_create();
+	cdict_set_probing(dict, probing);
+	cdict_set_max_load(dict, max_load);
+
+	for (size_t i = 0; i < n_keys; i++)
+	{
+		ids[i] = next_id++;
+		key(str, ids[i]);
+		cdict_write(dict, str, 0, ids[i]);
+	}
+
+	printf("%s, %zu keys, %.2f max load\n", name, n_keys, max_load);
+	printf("%8s %12s %12s %10s %10s %10s %10s\n", "cycles", "load factor", "ns / cycle", "hit mean", "hit max",
+		"miss mean", "miss max");
+
+	for (size_t r = 0; r <= n_rounds; r++)
+	{
+		if (r > 0)
+		{
+			clock_gettime(CLOCK_MONOTONIC, &t);
+			for (size_t i = 0; i < CYCLES; i++)
+			{
+				j = rand() % n_keys;
+				key(str, ids[j]);
+				cdict_erase(dict, str, 0);
+				ids[j] = next_id++;
+				key(str, ids[j]);
+				cdict_write(dict, str, 0, ids[j]);
+			}
+		}
+
+		sample(0,       SAMPLES, &mean_hit,  &max_hit);
+		sample(next_id, SAMPLES, &mean_miss, &max_miss);
+
+		printf("%8zu %12.3f %12.1f %10.2f %10zu %10.2f %10zu\n",
+			r * CYCLES,
+			cdict_load_factor(dict),
+			r > 0 ? elapsed(t) * 1e9 / CYCLES : 0.0,
+			mean_hit,
+			max_hit,
+			mean_miss,
+			max_miss);
+	}
+
+	printf("\n");
+
+	if (cdict_error(dict))
+	{
+		printf("Dictionary errored during operation\n");
+	}
+
+	cdict_destroy(dict);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+sample(size_t id_offset, size_t n, double *mean, size_t *max)
+{
+	char str[32];
+	size_t probes;
+	size_t sum = 0;
+
+	*max = 0;
+
+	for (size_t i = 0; i < n; i++)
+	{
+		if (id_offset == 0)
+		{
+			key(str, ids[rand() % n_keys]);
+		}
+		else
+		{
+			key(str, id_offset + i);
+		}
+		probes = cdict_probe_length(dict, str, 0);
+		sum   += probes;
+		*max   = probes > *max ? probes : *max;
+	}
+
+	*mean = (double)sum / n;
+}
@@ -0,0 +1,227 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Builds a base dictionary, then creates a number of clones of it and overwrites a few keys in each, as done
+ * for per-request overlays. Reports the time taken by a first clone, which may have to prepare the base for
+ * sharing, then the time per clone, the time per overlay write, and how much the private memory of the
+ * process grew per clone, as its resident pages minus the file-backed ones, read from /proc/self/statm.
+ * Finally reports the time per clone of a base that got as many writes of its own since its last clone.
+ *
+ * usage : dict_clone [base entries] [clones] [writes per clone]
+ */
+
+#include <cassette/cobj.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static double elapsed  (struct timespec);
+static void   key      (char [static 32], size_t);
+static size_t unshared (void);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static size_t n_entries = 1000000;
+static size_t n_clones  = 32;
+static size_t n_writes  = 100;
+
+/************************************************************************************************************/
+/* MAIN *****************************************************************************************************/
+/************************************************************************************************************/
+
+int
+main(int argc, char **argv)
+{
+	struct timespec t;
+	cdict **clones;
+	cdict *base;
+	cdict *tmp;
+	char str[32];
+	double t_first;
+	double t_clone;
+	double t_write;
+	double t_again = 0.0;
+	size_t id;
+	size_t mem;
+	size_t mem_end;
+	size_t v;
+	bool ok = true;
+
+	/* Setup */
+
+	if (argc > 1)
+	{
+		n_entries = strtoul(argv[1], NULL, 10);
+	}
+
+	if (argc > 2)
+	{
+		n_clones = strtoul(argv[2], NULL, 10);
+	}
+
+	if (argc > 3)
+	{
+		n_writes = strtoul(argv[3], NULL, 10);
+	}
+
+	if (n_entries == 0 || !(clones = malloc(n_clones * sizeof(cdict*))))
+	{
+		return 1;
+	}
+
+	base = cdict_create();
+
+	for (size_t i = 0; i < n_entries; i++)
+	{
+		key(str, i);
+		cdict_write(base, str, 0, i);
+	}
+
+	/* Operations */
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	cdict_destroy(cdict_clone(base));
+	t_first = elapsed(t);
+
+	mem = unshared();
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < n_clones; i++)
+	{
+		clones[i] = cdict_clone(base);
+	}
+	t_clone = elapsed(t);
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < n_clones; i++)
+	{
+		for (size_t j = 0; j < n_writes; j++)
+		{
+			key(str, (i * n_writes + j) * 7919 % n_entries);
+			cdict_write(clones[i], str, 0, SIZE_MAX);
+		}
+	}
+	t_write = elapsed(t);
+	mem_end = unshared();
+
+	/* the base rewrites its own values, so that it stays as it was */
+
+	for (size_t i = 0; i < n_clones; i++)
+	{
+		for (size_t j = 0; j < n_writes; j++)
+		{
+			id = (i * n_writes + j) * 104729 % n_entries;
+			key(str, id);
+			cdict_write(base, str, 0, id);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t);
+		tmp = cdict_clone(base);
+		t_again += elapsed(t);
+		cdict_destroy(tmp);
+	}
+
+	printf("%12s %10s %14s %14s %14s %14s %14s\n", "entries", "clones", "first us", "us / clone", "ns / write",
+		"KB / clone", "us / reclone");
+	printf("%12zu %10zu %14.1f %14.1f %14.1f %14.1f %14.1f\n",
+		n_entries,
+		n_clones,
+		t_first * 1e6,
+		t_clone * 1e6 / n_clones,
+		n_writes > 0 ? t_write * 1e9 / (n_clones * n_writes) : 0.0,
+		((double)mem_end - mem) / n_clones / 1024,
+		t_again * 1e6 / n_clones);
+
+	/* the base is left untouched by the overlays */
+
+	for (size_t i = 0; i < n_entries; i += 97)
+	{
+		key(str, i);
+		ok = ok && cdict_find(base, str, 0, &v) && v == i;
+	}
+
+	/* End */
+
+	if (!ok || cdict_error(base))
+	{
+		printf("Dictionary errored during operation\n");
+	}
+
+	for (size_t i = 0; i < n_clones; i++)
+	{
+		cdict_destroy(clones[i]);
+	}
+
+	cdict_destroy(base);
+	free(clones);
+
+	return 0;
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static double
+elapsed(struct timespec t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+key(char str[static 32], size_t id)
+{
+	snprintf(str, 32, "key-%zu", id);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+unshared(void)
+{
+	FILE *file;
+	size_t resident = 0;
+	size_t shared   = 0;
+
+	if ((file = fopen("/proc/self/statm", "r")))
+	{
+		if (fscanf(file, "%*u %zu %zu", &resident, &shared) != 2)
+		{
+			resident = 0;
+			shared   = 0;
+		}
+		fclose(file);
+	}
+
+	return (resident - shared) * sysconf(_SC_PAGESIZE);
+}
@@ -0,0 +1,258 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Compares the CDICT_PROBE_GROUPS, CDICT_PROBE_ROBIN_HOOD and CDICT_PROBE_CUCKOO modes on dictionaries
+ * filled up to growing load factors. Reports the time per write while filling them, the time per successful
+ * and failed lookup, and the longest probe of both kinds of lookups as counted by cdict_probe_length(), which
+ * bounds the worst case latency of each mode. Each mode is first checked for correctness: dictionaries are
+ * grown a few slots at a time with cdict_set_resize_step() while keys get written and erased, then every key
+ * is looked up to make sure that none got lost or brought back along the way.
+ *
+ * usage : dict_cuckoo [entries]
+ */
+
+#include <cassette/cobj.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define LOOKUPS 1000000
+#define KEY_LEN 32
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static void   check   (enum cdict_probing);
+static double elapsed (struct timespec);
+static double look_up (const cdict *, const char *, size_t *);
+static void   run     (enum cdict_probing, double);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static const char *names[] = {"groups", "robin hood", "perfect", "cuckoo"};
+static char *hits          = NULL;
+static char *misses        = NULL;
+static size_t n_entries    = 1000000;
+
+/************************************************************************************************************/
+/* MAIN *****************************************************************************************************/
+/************************************************************************************************************/
+
+int
+main(int argc, char **argv)
+{
+	const double loads[] = {0.5, 0.7, 0.8, 0.9};
+
+	/* Setup */
+
+	if (argc > 1)
+	{
+		n_entries = strtoul(argv[1], NULL, 10);
+	}
+
+	if (n_entries == 0 || !(hits = malloc(LOOKUPS * KEY_LEN)) || !(misses = malloc(LOOKUPS * KEY_LEN)))
+	{
+		free(hits);
+		return 1;
+	}
+
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		snprintf(hits   + i * KEY_LEN, KEY_LEN, "key-%zu", ((size_t)rand() * RAND_MAX + rand()) % n_entries);
+		snprintf(misses + i * KEY_LEN, KEY_LEN, "nil-%zu", i);
+	}
+
+	/* Operations */
+
+	check(CDICT_PROBE_GROUPS);
+	check(CDICT_PROBE_ROBIN_HOOD);
+	check(CDICT_PROBE_CUCKOO);
+
+	printf("%6s %12s %10s %10s %10s %10s %10s\n",
+		"load", "mode", "write ns", "hit ns", "miss ns", "hit max", "miss max");
+
+	for (size_t i = 0; i < sizeof(loads) / sizeof(loads[0]); i++)
+	{
+		run(CDICT_PROBE_GROUPS,     loads[i]);
+		run(CDICT_PROBE_ROBIN_HOOD, loads[i]);
+		run(CDICT_PROBE_CUCKOO,     loads[i]);
+	}
+
+	/* End */
+
+	free(hits);
+	free(misses);
+
+	return 0;
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static void
+check(enum cdict_probing probing)
+{
+	cdict *dict;
+	char str[KEY_LEN];
+	size_t n_lost = 0;
+	size_t v;
+	bool found;
+	bool erased;
+
+	/* a high load and small resize steps keep the dictionary in the middle of a resize most of the time */
+
+	dict = cdict_create();
+	cdict_set_probing(dict, probing);
+	cdict_set_max_load(dict, 0.9);
+	cdict_set_resize_step(dict, 8);
+
+	for (size_t i = 0; i < n_entries; i++)
+	{
+		snprintf(str, KEY_LEN, "key-%zu", i);
+		cdict_write(dict, str, 0, i);
+		if (i % 3 == 2)
+		{
+			snprintf(str, KEY_LEN, "key-%zu", i / 2);
+			cdict_erase(dict, str, 0);
+		}
+	}
+
+	/* key i got erased at the write of key 2i or 2i + 1, whichever came third */
+
+	for (size_t i = 0; i < n_entries; i++)
+	{
+		snprintf(str, KEY_LEN, "key-%zu", i);
+		found   = cdict_find(dict, str, 0, &v);
+		erased  = (i * 2 % 3 == 2 && i * 2 < n_entries) || ((i * 2 + 1) % 3 == 2 && i * 2 + 1 < n_entries);
+		n_lost += found == erased || (found && v != i);
+	}
+
+	printf("%-12s check : %s (%zu keys lost or brought back)\n",
+		names[probing],
+		n_lost == 0 && !cdict_error(dict) ? "ok" : "FAILED",
+		n_lost);
+
+	cdict_destroy(dict);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static double
+elapsed(struct timespec t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static double
+look_up(const cdict *dict, const char *chars, size_t *probes_max)
+{
+	struct timespec t;
+	size_t found = 0;
+	size_t v;
+	size_t p;
+	double t_look_up;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		found += cdict_find(dict, chars + i * KEY_LEN, 0, &v);
+	}
+	t_look_up = elapsed(t) * 1e9 / LOOKUPS;
+
+	if (found > LOOKUPS)
+	{
+		printf("Dictionary errored during operation\n");
+	}
+
+	/* probe lengths are measured separately so that they don't weigh on the timings */
+
+	*probes_max = 0;
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		p           = cdict_probe_length(dict, chars + i * KEY_LEN, 0);
+		*probes_max = p > *probes_max ? p : *probes_max;
+	}
+
+	return t_look_up;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+run(enum cdict_probing probing, double load)
+{
+	struct timespec t;
+	cdict *dict;
+	char str[KEY_LEN];
+	double t_write;
+	double t_hit;
+	double t_miss;
+	size_t p_hit;
+	size_t p_miss;
+
+	/* the table is preallocated so that it ends up filled to the given load, without growing on the way */
+
+	dict = cdict_create();
+	cdict_set_probing(dict, probing);
+	cdict_set_max_load(dict, load);
+	cdict_prealloc(dict, n_entries);
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < n_entries; i++)
+	{
+		snprintf(str, KEY_LEN, "key-%zu", i);
+		cdict_write(dict, str, 0, i);
+	}
+	t_write = elapsed(t) * 1e9 / n_entries;
+
+	t_hit  = look_up(dict, hits,   &p_hit);
+	t_miss = look_up(dict, misses, &p_miss);
+
+	printf("%6.2f %12s %10.1f %10.1f %10.1f %10zu %10zu\n",
+		cdict_load_factor(dict),
+		names[probing],
+		t_write,
+		t_hit,
+		t_miss,
+		p_hit,
+		p_miss);
+
+	if (cdict_error(dict))
+	{
+		printf("Dictionary errored during operation\n");
+	}
+
+	cdict_destroy(dict);
+}
@@ -0,0 +1,199 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Compares the time per random lookup of dictionaries created with and without CDICT_HUGE_PAGES, on
+ * dictionaries of growing sizes from 1M entries up to the given maximum. Half of the looked up keys are
+ * missing. Also reports the time per write while filling them, and how much of the process' anonymous
+ * memory the kernel backed with transparent huge pages, as read from /proc on Linux.
+ *
+ * usage : dict_hugepages [max entries]
+ */
+
+#include <cassette/cobj.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define LOOKUPS 1000000
+#define KEY_LEN 32
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static double elapsed     (struct timespec);
+static size_t huge_memory (void);
+static double run         (size_t, unsigned int, double *, size_t *);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static char *chars  = NULL;
+static size_t n_max = 16000000;
+
+/************************************************************************************************************/
+/* MAIN *****************************************************************************************************/
+/************************************************************************************************************/
+
+int
+main(int argc, char **argv)
+{
+	double t_plain;
+	double t_huge;
+	double w_plain;
+	double w_huge;
+	size_t m_plain;
+	size_t m_huge;
+
+	/* Setup */
+
+	if (argc > 1)
+	{
+		n_max = strtoul(argv[1], NULL, 10);
+	}
+
+	if (!(chars = malloc(LOOKUPS * KEY_LEN)))
+	{
+		return 1;
+	}
+
+	/* Operations */
+
+	printf("%12s %12s %12s %10s %12s %12s %12s %12s\n",
+		"entries", "plain ns", "huge ns", "speedup", "plain w ns", "huge w ns", "plain THP MB", "huge THP MB");
+
+	for (size_t n = 1000000; n <= n_max; n *= 2)
+	{
+		for (size_t i = 0; i < LOOKUPS; i++)
+		{
+			snprintf(chars + i * KEY_LEN, KEY_LEN, i % 2 ? "nil-%zu" : "key-%zu",
+				((size_t)rand() * RAND_MAX + rand()) % n);
+		}
+
+		t_plain = run(n, 0,                &w_plain, &m_plain);
+		t_huge  = run(n, CDICT_HUGE_PAGES, &w_huge,  &m_huge);
+
+		printf("%12zu %12.1f %12.1f %9.2fx %12.1f %12.1f %12zu %12zu\n",
+			n,
+			t_plain,
+			t_huge,
+			t_plain / t_huge,
+			w_plain,
+			w_huge,
+			m_plain >> 20,
+			m_huge  >> 20);
+	}
+
+	/* End */
+
+	free(chars);
+
+	return 0;
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static double
+elapsed(struct timespec t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+huge_memory(void)
+{
+	FILE *file;
+	char line[256];
+	size_t kb = 0;
+
+	if (!(file = fopen("/proc/self/smaps_rollup", "r")))
+	{
+		return 0;
+	}
+
+	while (fgets(line, sizeof(line), file))
+	{
+		if (strncmp(line, "AnonHugePages:", 14) == 0)
+		{
+			kb = strtoul(line + 14, NULL, 10);
+			break;
+		}
+	}
+
+	fclose(file);
+
+	return kb << 10;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static double
+run(size_t n, unsigned int flags, double *t_write, size_t *huge)
+{
+	struct timespec t;
+	cdict *dict;
+	char str[KEY_LEN];
+	size_t hits = 0;
+	size_t v;
+	double t_look_up;
+
+	dict = cdict_create_with_flags(flags);
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < n; i++)
+	{
+		snprintf(str, KEY_LEN, "key-%zu", i);
+		cdict_write(dict, str, 0, i);
+	}
+	*t_write = elapsed(t) * 1e9 / n;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		hits += cdict_find(dict, chars + i * KEY_LEN, 0, &v);
+	}
+	t_look_up = elapsed(t) * 1e9 / LOOKUPS;
+
+	*huge = huge_memory();
+
+	if (cdict_error(dict) || hits != LOOKUPS / 2)
+	{
+		printf("Dictionary errored during operation\n");
+	}
+
+	cdict_destroy(dict);
+
+	return t_look_up;
+}
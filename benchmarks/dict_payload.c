@@ -0,0 +1,193 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Compares two ways of attaching a 32-byte record to each key. The first one stores the index of the record
+ * as the key's value and reads it from a side array, the second one stores the record inline in the
+ * dictionary with cdict_create_with_value_size() and reads it in place with cdict_find_ref(). Reports the
+ * time per lookup that reads a field of the record, on dictionaries of growing sizes from 1K entries up to
+ * the given maximum.
+ *
+ * usage : dict_payload [max entries]
+ */
+
+#include <cassette/cobj.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define LOOKUPS 1000000
+#define KEY_LEN 32
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+struct record
+{
+	uint64_t id;
+	uint64_t stamp;
+	double score;
+	uint32_t flags;
+	uint32_t owner;
+};
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static double elapsed (struct timespec);
+static void   run     (size_t);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static char *chars  = NULL;
+static size_t n_max = 10000000;
+
+/************************************************************************************************************/
+/* MAIN *****************************************************************************************************/
+/************************************************************************************************************/
+
+int
+main(int argc, char **argv)
+{
+	/* Setup */
+
+	if (argc > 1)
+	{
+		n_max = strtoul(argv[1], NULL, 10);
+	}
+
+	if (!(chars = malloc(LOOKUPS * KEY_LEN)))
+	{
+		return 1;
+	}
+
+	/* Operations */
+
+	printf("%12s %12s %12s %10s\n", "entries", "side ns", "inline ns", "speedup");
+
+	for (size_t n = 1000; n <= n_max; n *= 10)
+	{
+		run(n);
+	}
+
+	/* End */
+
+	free(chars);
+
+	return 0;
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static double
+elapsed(struct timespec t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+run(size_t n)
+{
+	const struct record *ref;
+	struct record *records;
+	struct record r = {0};
+	struct timespec t;
+	cdict *dict_side;
+	cdict *dict_inline;
+	char str[KEY_LEN];
+	double t_side;
+	double t_inline;
+	size_t sum_side = 0;
+	size_t sum_inline = 0;
+	size_t v;
+
+	if (!(records = malloc(n * sizeof(struct record))))
+	{
+		return;
+	}
+
+	dict_side   = cdict_create();
+	dict_inline = cdict_create_with_value_size(sizeof(struct record));
+
+	for (size_t i = 0; i < n; i++)
+	{
+		r.id    = i;
+		r.owner = (uint32_t)(i % 97);
+
+		snprintf(str, KEY_LEN, "key-%zu", i);
+		records[i] = r;
+		cdict_write(dict_side, str, 0, i);
+		cdict_write_ref(dict_inline, str, 0, &r);
+	}
+
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		snprintf(chars + i * KEY_LEN, KEY_LEN, "key-%zu", ((size_t)rand() * RAND_MAX + rand()) % n);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		if (cdict_find(dict_side, chars + i * KEY_LEN, 0, &v))
+		{
+			sum_side += records[v].owner;
+		}
+	}
+	t_side = elapsed(t) * 1e9 / LOOKUPS;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		if ((ref = cdict_find_ref(dict_inline, chars + i * KEY_LEN, 0)))
+		{
+			sum_inline += ref->owner;
+		}
+	}
+	t_inline = elapsed(t) * 1e9 / LOOKUPS;
+
+	printf("%12zu %12.1f %12.1f %9.2fx\n", n, t_side, t_inline, t_side / t_inline);
+
+	if (cdict_error(dict_side) || cdict_error(dict_inline) || sum_side != sum_inline)
+	{
+		printf("Dictionary errored during operation\n");
+	}
+
+	cdict_destroy(dict_side);
+	cdict_destroy(dict_inline);
+	free(records);
+}
@@ -0,0 +1,187 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Compares the time per lookup of a dictionary in its default probing mode and after switching it to
+ * CDICT_PROBE_PERFECT, on dictionaries of growing sizes from 1K entries up to the given maximum. Also reports
+ * how long the perfect hash function took to build, and the number of hashtable bytes per entry in both modes
+ * (control bytes, pilots and slot indices, entries themselves excluded).
+ *
+ * usage : dict_perfect [max entries]
+ */
+
+#include <cassette/cobj.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define LOOKUPS 1000000
+#define KEY_LEN 32
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static double elapsed (struct timespec);
+static double look_up (const cdict *);
+static void   run     (size_t);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static char *chars  = NULL;
+static size_t n_max = 10000000;
+
+/************************************************************************************************************/
+/* MAIN *****************************************************************************************************/
+/************************************************************************************************************/
+
+int
+main(int argc, char **argv)
+{
+	/* Setup */
+
+	if (argc > 1)
+	{
+		n_max = strtoul(argv[1], NULL, 10);
+	}
+
+	if (!(chars = malloc(LOOKUPS * KEY_LEN)))
+	{
+		return 1;
+	}
+
+	/* Operations */
+
+	printf("%12s %12s %12s %10s %12s %12s %12s\n",
+		"entries", "groups ns", "perfect ns", "speedup", "build ms", "groups B/e", "perfect B/e");
+
+	for (size_t n = 1000; n <= n_max; n *= 10)
+	{
+		run(n);
+	}
+
+	/* End */
+
+	free(chars);
+
+	return 0;
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static double
+elapsed(struct timespec t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static double
+look_up(const cdict *dict)
+{
+	struct timespec t;
+	size_t hits = 0;
+	size_t v;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		if (cdict_find(dict, chars + i * KEY_LEN, 0, &v))
+		{
+			hits += v & 1;
+		}
+	}
+
+	if (hits > LOOKUPS)
+	{
+		printf("Dictionary errored during operation\n");
+	}
+
+	return elapsed(t) * 1e9 / LOOKUPS;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+run(size_t n)
+{
+	struct timespec t;
+	cdict *dict;
+	char str[KEY_LEN];
+	double t_groups;
+	double t_perfect;
+	double t_build;
+	double b_groups;
+
+	dict = cdict_create();
+	cdict_prealloc(dict, n);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		snprintf(str, KEY_LEN, "key-%zu", i);
+		cdict_write(dict, str, 0, i);
+	}
+
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		snprintf(chars + i * KEY_LEN, KEY_LEN, "key-%zu", ((size_t)rand() * RAND_MAX + rand()) % n);
+	}
+
+	/* a group probing slot takes a control byte and a 4-byte index, a perfect one only the index, plus */
+	/* one 4-byte pilot per bucket of 2 keys on average                                                 */
+
+	t_groups = look_up(dict);
+	b_groups = 5.0 * cdict_load(dict) / cdict_load_factor(dict) / n;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	cdict_set_probing(dict, CDICT_PROBE_PERFECT);
+	t_build = elapsed(t);
+
+	t_perfect = look_up(dict);
+
+	printf("%12zu %12.1f %12.1f %9.2fx %12.1f %12.1f %12.1f\n",
+		n,
+		t_groups,
+		t_perfect,
+		t_groups / t_perfect,
+		t_build * 1e3,
+		b_groups,
+		4.0 + 4.0 / 2);
+
+	if (cdict_error(dict))
+	{
+		printf("Dictionary errored during operation\n");
+	}
+
+	cdict_destroy(dict);
+}
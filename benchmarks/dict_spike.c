@@ -0,0 +1,193 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Fills a dictionary with a traffic spike of keys, then erases all but a fraction of them and reports the
+ * load factor and the time per lookup of the remaining keys and of missing keys, before and after the spike.
+ * The spike is then repeated with a final call to cdict_shrink_to_fit().
+ *
+ * usage : dict_spike [peak keys] [kept keys]
+ */
+
+#include <cassette/cobj.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define LOOKUPS 1000000
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static double elapsed (struct timespec);
+static void   key     (char [static 32], size_t);
+static double look_up (size_t);
+static void   report  (const char *, double);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static cdict *dict   = CDICT_PLACEHOLDER;
+static size_t n_peak = 4000000;
+static size_t n_kept = 40000;
+
+/************************************************************************************************************/
+/* MAIN *****************************************************************************************************/
+/************************************************************************************************************/
+
+int
+main(int argc, char **argv)
+{
+	struct timespec t;
+	char str[32];
+	double t_erase;
+
+	/* Setup */
+
+	if (argc > 1)
+	{
+		n_peak = strtoul(argv[1], NULL, 10);
+	}
+
+	if (argc > 2)
+	{
+		n_kept = strtoul(argv[2], NULL, 10);
+	}
+
+	if (n_kept == 0 || n_kept > n_peak)
+	{
+		return 1;
+	}
+
+	dict = cdict_create();
+
+	for (size_t i = 0; i < n_kept; i++)
+	{
+		key(str, i);
+		cdict_write(dict, str, 0, i);
+	}
+
+	/* Operations */
+
+	printf("%24s %12s %10s %10s %12s\n", "", "load factor", "hit ns", "miss ns", "erase ns");
+
+	report("before spike", 0.0);
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (size_t i = n_kept; i < n_peak; i++)
+		{
+			key(str, i);
+			cdict_write(dict, str, 0, i);
+		}
+
+		report("at peak", 0.0);
+
+		clock_gettime(CLOCK_MONOTONIC, &t);
+		for (size_t i = n_kept; i < n_peak; i++)
+		{
+			key(str, i);
+			cdict_erase(dict, str, 0);
+		}
+		t_erase = elapsed(t) * 1e9 / (n_peak - n_kept);
+
+		if (pass == 0)
+		{
+			report("after spike", t_erase);
+		}
+		else
+		{
+			cdict_shrink_to_fit(dict);
+			report("after spike, shrunk", t_erase);
+		}
+	}
+
+	/* End */
+
+	if (cdict_error(dict))
+	{
+		printf("Dictionary errored during operation\n");
+	}
+
+	cdict_destroy(dict);
+
+	return 0;
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static double
+elapsed(struct timespec t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+key(char str[static 32], size_t id)
+{
+	snprintf(str, 32, "key-%zu", id);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static double
+look_up(size_t id_offset)
+{
+	struct timespec t;
+	char str[32];
+	size_t hits = 0;
+	size_t v;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		key(str, id_offset + (i * 7919) % n_kept);
+		hits += cdict_find(dict, str, 0, &v);
+	}
+
+	return hits > LOOKUPS ? 0.0 : elapsed(t) * 1e9 / LOOKUPS;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+report(const char *stage, double t_erase)
+{
+	printf("%24s %12.3f %10.1f %10.1f %12.1f\n",
+		stage,
+		cdict_load_factor(dict),
+		look_up(0),
+		look_up(n_peak),
+		t_erase);
+}
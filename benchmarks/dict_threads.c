@@ -0,0 +1,256 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Compares the lookup throughput of a growing number of reader threads sharing one dictionary, first with
+ * every cdict_find() call wrapped in a read-write lock, then with a dictionary created with the
+ * CDICT_CONCURRENT_READS flag and no lock. In both cases a writer thread keeps updating values, inserting
+ * and erasing keys every millisecond while readers run.
+ *
+ * usage : dict_threads [entries] [max threads]
+ */
+
+#include <cassette/cobj.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define LOOKUPS 1000000
+#define KEY_LEN 32
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static double elapsed (struct timespec);
+static void  *look_up (void *);
+static double run     (size_t, bool);
+static void  *update  (void *);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static pthread_rwlock_t lock = PTHREAD_RWLOCK_INITIALIZER;
+static atomic_bool reading   = false;
+static atomic_size_t misses  = 0;
+static cdict *dict           = CDICT_PLACEHOLDER;
+static char *chars           = NULL;
+static bool locked           = false;
+static size_t n_entries      = 1000000;
+static size_t n_threads      = 32;
+
+/************************************************************************************************************/
+/* MAIN *****************************************************************************************************/
+/************************************************************************************************************/
+
+int
+main(int argc, char **argv)
+{
+	double t_lock;
+	double t_free;
+
+	/* Setup */
+
+	if (argc > 1)
+	{
+		n_entries = strtoul(argv[1], NULL, 10);
+	}
+
+	if (argc > 2)
+	{
+		n_threads = strtoul(argv[2], NULL, 10);
+	}
+
+	if (n_entries == 0 || !(chars = malloc(LOOKUPS * KEY_LEN)))
+	{
+		return 1;
+	}
+
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		snprintf(chars + i * KEY_LEN, KEY_LEN, "key-%zu", ((size_t)rand() * RAND_MAX + rand()) % n_entries);
+	}
+
+	/* Operations */
+
+	printf("%8s %16s %16s %10s\n", "threads", "rwlock M/s", "lock-free M/s", "speedup");
+
+	for (size_t n = 1; n <= n_threads; n *= 2)
+	{
+		t_lock = run(n, true);
+		t_free = run(n, false);
+
+		printf("%8zu %16.1f %16.1f %9.2fx\n",
+			n,
+			n * LOOKUPS / t_lock / 1e6,
+			n * LOOKUPS / t_free / 1e6,
+			t_lock / t_free);
+	}
+
+	if (atomic_load(&misses) > 0)
+	{
+		printf("%zu lookups failed\n", atomic_load(&misses));
+	}
+
+	/* End */
+
+	free(chars);
+
+	return 0;
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static double
+elapsed(struct timespec t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void *
+look_up(void *arg)
+{
+	size_t offset = (size_t)arg;
+	size_t n      = 0;
+	size_t v;
+	bool found;
+
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		if (locked)
+		{
+			pthread_rwlock_rdlock(&lock);
+		}
+		found = cdict_find(dict, chars + (i + offset) % LOOKUPS * KEY_LEN, 0, &v);
+		if (locked)
+		{
+			pthread_rwlock_unlock(&lock);
+		}
+		n += !found;
+	}
+
+	atomic_fetch_add(&misses, n);
+
+	return NULL;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static double
+run(size_t n, bool with_lock)
+{
+	struct timespec t;
+	pthread_t *readers;
+	pthread_t writer;
+	char str[KEY_LEN];
+	double t_run;
+
+	if (!(readers = malloc(n * sizeof(pthread_t))))
+	{
+		return 0.0;
+	}
+
+	dict   = cdict_create_with_flags(with_lock ? 0 : CDICT_CONCURRENT_READS);
+	locked = with_lock;
+
+	cdict_prealloc(dict, n_entries);
+
+	for (size_t i = 0; i < n_entries; i++)
+	{
+		snprintf(str, KEY_LEN, "key-%zu", i);
+		cdict_write(dict, str, 0, i);
+	}
+
+	atomic_store(&reading, true);
+	pthread_create(&writer, NULL, update, NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < n; i++)
+	{
+		pthread_create(readers + i, NULL, look_up, (void*)(i * LOOKUPS / n));
+	}
+	for (size_t i = 0; i < n; i++)
+	{
+		pthread_join(readers[i], NULL);
+	}
+	t_run = elapsed(t);
+
+	atomic_store(&reading, false);
+	pthread_join(writer, NULL);
+
+	if (cdict_error(dict))
+	{
+		printf("Dictionary errored during operation\n");
+	}
+
+	cdict_destroy(dict);
+	free(readers);
+
+	return t_run;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void *
+update(void *arg)
+{
+	struct timespec pause = {.tv_sec = 0, .tv_nsec = 1000000};
+	char str[KEY_LEN];
+
+	(void)arg;
+
+	/* existing keys keep their value so that readers always find them */
+
+	for (size_t i = 0; atomic_load(&reading); i++)
+	{
+		if (locked)
+		{
+			pthread_rwlock_wrlock(&lock);
+		}
+		snprintf(str, KEY_LEN, "key-%zu", i % n_entries);
+		cdict_write(dict, str, 0, i % n_entries);
+		snprintf(str, KEY_LEN, "tmp-%zu", i);
+		cdict_write(dict, str, 0, i);
+		snprintf(str, KEY_LEN, "tmp-%zu", i - 1);
+		cdict_erase(dict, str, 0);
+		if (locked)
+		{
+			pthread_rwlock_unlock(&lock);
+		}
+		nanosleep(&pause, NULL);
+	}
+
+	return NULL;
+}
@@ -0,0 +1,195 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Compares the write throughput of a growing number of threads inserting distinct keys into a shared
+ * dictionary, first into a cdict guarded by a single mutex, then into a cshard with several shards per
+ * thread. Every run starts from empty dictionaries, so that writes also pay for growing them.
+ *
+ * usage : shard_writers [writes per thread] [max threads] [shards]
+ */
+
+#include <cassette/cobj.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define KEY_LEN 32
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static double elapsed     (struct timespec);
+static double run         (size_t, void *(*)(void *));
+static void  *write_dict  (void *);
+static void  *write_shard (void *);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static cdict *dict          = CDICT_PLACEHOLDER;
+static cshard *shard        = CSHARD_PLACEHOLDER;
+static size_t n_writes      = 1000000;
+static size_t n_threads     = 32;
+static size_t n_shards      = 64;
+
+/************************************************************************************************************/
+/* MAIN *****************************************************************************************************/
+/************************************************************************************************************/
+
+int
+main(int argc, char **argv)
+{
+	double t_dict;
+	double t_shard;
+
+	/* Setup */
+
+	if (argc > 1)
+	{
+		n_writes = strtoul(argv[1], NULL, 10);
+	}
+
+	if (argc > 2)
+	{
+		n_threads = strtoul(argv[2], NULL, 10);
+	}
+
+	if (argc > 3)
+	{
+		n_shards = strtoul(argv[3], NULL, 10);
+	}
+
+	/* Operations */
+
+	printf("%8s %16s %16s %10s\n", "threads", "mutex M/s", "sharded M/s", "speedup");
+
+	for (size_t n = 1; n <= n_threads; n *= 2)
+	{
+		dict    = cdict_create();
+		t_dict  = run(n, write_dict);
+		shard   = cshard_create(n_shards);
+		t_shard = run(n, write_shard);
+
+		printf("%8zu %16.1f %16.1f %9.2fx\n",
+			n,
+			n * n_writes / t_dict  / 1e6,
+			n * n_writes / t_shard / 1e6,
+			t_dict / t_shard);
+
+		if (cdict_error(dict) || cshard_error(shard) || cdict_load(dict) != cshard_load(shard))
+		{
+			printf("Dictionaries errored during operation\n");
+		}
+
+		cdict_destroy(dict);
+		cshard_destroy(shard);
+	}
+
+	/* End */
+
+	return 0;
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static double
+elapsed(struct timespec t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static double
+run(size_t n, void *(*fn)(void *))
+{
+	struct timespec t;
+	pthread_t *writers;
+	double t_run;
+
+	if (!(writers = malloc(n * sizeof(pthread_t))))
+	{
+		return 0.0;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < n; i++)
+	{
+		pthread_create(writers + i, NULL, fn, (void*)i);
+	}
+	for (size_t i = 0; i < n; i++)
+	{
+		pthread_join(writers[i], NULL);
+	}
+	t_run = elapsed(t);
+
+	free(writers);
+
+	return t_run;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void *
+write_dict(void *arg)
+{
+	char str[KEY_LEN];
+
+	for (size_t i = 0; i < n_writes; i++)
+	{
+		snprintf(str, KEY_LEN, "key-%zu-%zu", (size_t)arg, i);
+		pthread_mutex_lock(&lock);
+		cdict_write(dict, str, 0, i);
+		pthread_mutex_unlock(&lock);
+	}
+
+	return NULL;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void *
+write_shard(void *arg)
+{
+	char str[KEY_LEN];
+
+	for (size_t i = 0; i < n_writes; i++)
+	{
+		snprintf(str, KEY_LEN, "key-%zu-%zu", (size_t)arg, i);
+		cshard_write(shard, str, 0, i);
+	}
+
+	return NULL;
+}
@@ -0,0 +1,222 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Compares point lookups in a cdict and in a ctrie holding the same keys, on growing numbers of entries from
+ * 1K up to the given maximum. Reports the time per write while filling them, and per successful and failed
+ * lookup. Also reports the time per entry listed by ctrie prefix scans over random 3-digit prefixes, and by a
+ * full ordered iteration, which a cdict cannot do without sorting its keys first.
+ *
+ * usage : trie_lookup [max entries]
+ */
+
+#include <cassette/cobj.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define LOOKUPS 1000000
+#define KEY_LEN 32
+#define SCANS   1000
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static double elapsed (struct timespec);
+static void   run     (size_t);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static char *hits   = NULL;
+static char *misses = NULL;
+static size_t n_max = 1000000;
+
+/************************************************************************************************************/
+/* MAIN *****************************************************************************************************/
+/************************************************************************************************************/
+
+int
+main(int argc, char **argv)
+{
+	/* Setup */
+
+	if (argc > 1)
+	{
+		n_max = strtoul(argv[1], NULL, 10);
+	}
+
+	if (!(hits = malloc(LOOKUPS * KEY_LEN)) || !(misses = malloc(LOOKUPS * KEY_LEN)))
+	{
+		free(hits);
+		return 1;
+	}
+
+	/* Operations */
+
+	printf("%10s %6s %10s %10s %10s %10s %10s\n",
+		"entries", "type", "write ns", "hit ns", "miss ns", "prefix ns", "order ns");
+
+	for (size_t n = 1000; n <= n_max; n *= 10)
+	{
+		run(n);
+	}
+
+	/* End */
+
+	free(hits);
+	free(misses);
+
+	return 0;
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static double
+elapsed(struct timespec t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+run(size_t n)
+{
+	struct cdict_entry entry;
+	struct timespec t;
+	cdict *dict;
+	ctrie *trie;
+	char str[KEY_LEN];
+	double t_write[2];
+	double t_hit[2];
+	double t_miss[2];
+	double t_prefix;
+	double t_order;
+	size_t found = 0;
+	size_t listed = 0;
+
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		snprintf(hits   + i * KEY_LEN, KEY_LEN, "key-%zu", ((size_t)rand() * RAND_MAX + rand()) % n);
+		snprintf(misses + i * KEY_LEN, KEY_LEN, "nil-%zu", i);
+	}
+
+	/* cdict */
+
+	dict = cdict_create();
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < n; i++)
+	{
+		snprintf(str, KEY_LEN, "key-%zu", i);
+		cdict_write(dict, str, 0, i);
+	}
+	t_write[0] = elapsed(t) * 1e9 / n;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		found += cdict_find(dict, hits + i * KEY_LEN, 0, NULL);
+	}
+	t_hit[0] = elapsed(t) * 1e9 / LOOKUPS;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		found += cdict_find(dict, misses + i * KEY_LEN, 0, NULL);
+	}
+	t_miss[0] = elapsed(t) * 1e9 / LOOKUPS;
+
+	/* ctrie */
+
+	trie = ctrie_create();
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < n; i++)
+	{
+		snprintf(str, KEY_LEN, "key-%zu", i);
+		ctrie_write(trie, str, 0, i);
+	}
+	t_write[1] = elapsed(t) * 1e9 / n;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		found += ctrie_find(trie, hits + i * KEY_LEN, 0, NULL);
+	}
+	t_hit[1] = elapsed(t) * 1e9 / LOOKUPS;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < LOOKUPS; i++)
+	{
+		found += ctrie_find(trie, misses + i * KEY_LEN, 0, NULL);
+	}
+	t_miss[1] = elapsed(t) * 1e9 / LOOKUPS;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (size_t i = 0; i < SCANS; i++)
+	{
+		snprintf(str, KEY_LEN, "key-%zu", 100 + (size_t)rand() % 900);
+		CTRIE_FOR_EACH_IN_PREFIX(trie, str, 0, entry)
+		{
+			listed++;
+		}
+	}
+	t_prefix = elapsed(t) * 1e9 / (listed ? listed : 1);
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	CTRIE_FOR_EACH(trie, entry)
+	{
+		listed++;
+	}
+	t_order = elapsed(t) * 1e9 / n;
+
+	printf("%10zu %6s %10.1f %10.1f %10.1f %10s %10s\n", n, "cdict", t_write[0], t_hit[0], t_miss[0], "-", "-");
+	printf("%10zu %6s %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+		n,
+		"ctrie",
+		t_write[1],
+		t_hit[1],
+		t_miss[1],
+		t_prefix,
+		t_order);
+
+	if (cdict_error(dict) || ctrie_error(trie) || found != 2 * LOOKUPS)
+	{
+		printf("Index errored during operation\n");
+	}
+
+	cdict_destroy(dict);
+	ctrie_destroy(trie);
+}
@@ -0,0 +1,196 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "cerr.h"
+
+#if __GNUC__ > 4
+	#define CBLOOM_NONNULL_RETURN __attribute__((returns_nonnull))
+	#define CBLOOM_NONNULL(...)   __attribute__((nonnull (__VA_ARGS__)))
+	#define CBLOOM_PURE           __attribute__((pure))
+#else
+	#define CBLOOM_NONNULL_RETURN
+	#define CBLOOM_NONNULL(...)
+	#define CBLOOM_PURE
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/************************************************************************************************************/
+/* TYPES ****************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Opaque blocked Bloom filter object. It tells whether a 64-bit hash, like the ones of cdict keys, may have
+ * been added to it, or surely was not. Hashes can be added but never removed. The filter is split into
+ * blocks of 256 bits that never straddle a cache line, and each hash sets or tests 8 bits within a single
+ * block, one in each of its 32-bit words, so that a test touches a single cache line and is done with a
+ * few vector instructions (SSE2, or AVX2 when available). Its false positive rate mostly depends on the
+ * number of bits given to each hash: about 3% with 8 bits, 1.2% with 10, 0.5% with 12 and 0.1% with 16, and
+ * it quickly climbs below 8 bits.
+ *
+ * A filter can be attached to a dictionary with cdict_set_bloom() to answer most lookups of missing keys
+ * without probing its hashtable, and filled from a dictionary's stored hashes with cdict_fill_bloom().
+ *
+ * Tests can be made from many threads at once, as long as no hashes get added at the same time. If the
+ * filter could not be created, all methods will exit early with default return values and no side-effects.
+ */
+typedef struct cbloom cbloom;
+
+/************************************************************************************************************/
+/* GLOBALS **************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * A macro that gives uninitialized Bloom filters a non-NULL value that is safe to use with the Bloom
+ * filter's related functions. However, any function called with a handle set to this value will return
+ * early and without any side effects.
+ */
+#define CBLOOM_PLACEHOLDER (&cbloom_placeholder_instance)
+
+/**
+ * Global Bloom filter instance with the error state set to CERR_INVALID. This instance is made available to
+ * allow the static initialization of Bloom filter pointers with the macro CBLOOM_PLACEHOLDER.
+ */
+extern cbloom cbloom_placeholder_instance;
+
+/************************************************************************************************************/
+/* CONSTRUCTORS / DESTRUCTORS *******************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Creates a Bloom filter and copies the bits of another filter into it.
+ *
+ * @param bloom : Bloom filter to copy contents from
+ *
+ * @return     : New Bloom filter instance
+ * @return_err : CBLOOM_PLACEHOLDER
+ */
+cbloom *
+cbloom_clone(const cbloom *bloom)
+CBLOOM_NONNULL_RETURN
+CBLOOM_NONNULL(1);
+
+/**
+ * Creates an empty Bloom filter sized for a given number of hashes. Adding more hashes than that does not
+ * fail, but raises the false positive rate.
+ *
+ * @param hashes_number : Expected number of hashes to add
+ * @param bits_per_hash : Number of filter bits per expected hash, from 1 to 64, 10 is a good default
+ *
+ * @return     : New Bloom filter instance
+ * @return_err : CBLOOM_PLACEHOLDER, also returned if bits_per_hash is out of range or the filter would take
+ *               more than 128 GB
+ */
+cbloom *
+cbloom_create(size_t hashes_number, size_t bits_per_hash)
+CBLOOM_NONNULL_RETURN;
+
+/**
+ * Destroys the given Bloom filter and frees memory. It must not be attached to any dictionary anymore.
+ *
+ * @param bloom : Bloom filter to interact with
+ */
+void
+cbloom_destroy(cbloom *bloom)
+CBLOOM_NONNULL(1);
+
+/************************************************************************************************************/
+/* IMPURE METHODS *******************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Adds a hash to the filter. Later tests of the same hash will always succeed.
+ *
+ * @param bloom : Bloom filter to interact with
+ * @param hash  : Hash to add, like the hash field of a struct cdict_key
+ */
+void
+cbloom_add(cbloom *bloom, uint64_t hash)
+CBLOOM_NONNULL(1);
+
+/**
+ * Removes all hashes from the filter. Allocated memory is not freed, use cbloom_destroy() for that.
+ *
+ * @param bloom : Bloom filter to interact with
+ */
+void
+cbloom_clear(cbloom *bloom)
+CBLOOM_NONNULL(1);
+
+/************************************************************************************************************/
+/* PURE METHODS *********************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Gets the memory taken by the filter's bits.
+ *
+ * @param bloom : Bloom filter to interact with
+ *
+ * @return     : Size in bytes
+ * @return_err : 0
+ */
+size_t
+cbloom_bytes(const cbloom *bloom)
+CBLOOM_NONNULL(1)
+CBLOOM_PURE;
+
+/**
+ * Gets the error state.
+ *
+ * @param bloom : Bloom filter to interact with
+ *
+ * @return : Error value
+ */
+enum cerr
+cbloom_error(const cbloom *bloom)
+CBLOOM_NONNULL(1)
+CBLOOM_PURE;
+
+/**
+ * Tests if a hash may have been added to the filter. A false result is certain, a true one may be a false
+ * positive.
+ *
+ * @param bloom : Bloom filter to interact with
+ * @param hash  : Hash to test
+ *
+ * @return     : Possible match
+ * @return_err : true, so that an invalid filter never rules anything out
+ */
+bool
+cbloom_test(const cbloom *bloom, uint64_t hash)
+CBLOOM_NONNULL(1)
+CBLOOM_PURE;
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
@@ -54,6 +54,27 @@ extern "C" {
  */
 typedef struct cbook cbook;
 
+/**
+ * Creation-time options, to combine with a bitwise OR and pass to cbook_create_with_flags().
+ *
+ * CBOOK_INTERN : Words are interned. The characters of a word are only appended to the book the first time it
+ *                is written, further writes of the same string only add a word that points to those same
+ *                characters, so that repeated words cost no more than their word index. Writes then hash the
+ *                string and look it up in a side table first, which takes about 3 more word indexes of memory
+ *                per unique string. Equal words share the same ID, see cbook_word_id().
+ *
+ * CBOOK_COMPACT_OFFSETS : Word offsets and group indexes are stored on 4 bytes instead of the width of
+ *                         size_t, which halves the memory taken by each word on top of its characters on
+ *                         64-bit machines. Once the book holds more than 4 GB of characters or 4G words, both
+ *                         get widened back to size_t in a single pass, and stay so until the book's
+ *                         destruction.
+ */
+enum cbook_flag
+{
+	CBOOK_INTERN          = 1 << 0,
+	CBOOK_COMPACT_OFFSETS = 1 << 1,
+};
+
 /************************************************************************************************************/
 /* GLOBALS **************************************************************************************************/
 /************************************************************************************************************/
@@ -100,6 +121,18 @@ cbook *
 cbook_create(void)
 CBOOK_NONNULL_RETURN;
 
+/**
+ * Creates an empty book instance with the given options.
+ *
+ * @param flags : Bitwise OR of cbook_flag values, or 0 to get the same book as cbook_create()
+ *
+ * @return     : New book instance
+ * @return_err : CBOOK_PLACEHOLDER
+ */
+cbook *
+cbook_create_with_flags(unsigned int flags)
+CBOOK_NONNULL_RETURN;
+
 /**
  * Destroys the given book and frees memory.
  *
@@ -209,7 +242,8 @@ CBOOK_NONNULL(1);
 /**
  * Appends a new word to the book and increments the book word count (and possibly group count) by 1 as well
  * as the character count by the string's length (NUL terminator included). The book will automatically extend
- * its allocated memory to accommodate the new word.
+ * its allocated memory to accommodate the new word. In books created with CBOOK_INTERN, the character count
+ * is left untouched if an equal word is already in the book.
  * 
  * @param book : Book to interact with
  * @param str  : C string
@@ -246,6 +280,22 @@ cbook_error(const cbook *book)
 CBOOK_NONNULL(1)
 CBOOK_PURE;
 
+/**
+ * Gets the ID shared by the words of an interned book that are equal to the given string, as returned by
+ * cbook_word_id(), without adding a word. Only books created with CBOOK_INTERN can be searched, the
+ * default return_err value is always returned for other books.
+ *
+ * @param book : Book to interact with
+ * @param str  : C string
+ *
+ * @return     : Word ID
+ * @return_err : SIZE_MAX, also returned if the string is not in the book
+ */
+size_t
+cbook_find_id(const cbook *book, const char *str)
+CBOOK_NONNULL(1, 2)
+CBOOK_PURE;
+
 /**
  * Gets a group's word count. If group_index is out of bounds, the default return_err value is returned.
  * 
@@ -301,6 +351,23 @@ CBOOK_NONNULL_RETURN
 CBOOK_NONNULL(1)
 CBOOK_PURE;
 
+/**
+ * Gets a word's ID, which is the offset of its characters in the book. In books created with CBOOK_INTERN,
+ * equal words share their characters and thus their ID, so they can be compared as integers instead of
+ * strings. Otherwise, each word gets its own ID. An ID stays the same until its word is popped or the book
+ * cleared. If word_index is out of bounds, the default return_err value is returned.
+ *
+ * @param book       : Book to interact with
+ * @param word_index : Word index in book across all groups
+ *
+ * @return     : Word ID
+ * @return_err : SIZE_MAX
+ */
+size_t
+cbook_word_id(const cbook *book, size_t word_index)
+CBOOK_NONNULL(1)
+CBOOK_PURE;
+
 /**
  * Gets a word from a specific group. If group_index or word_index are out of bounds, the default return_err
  * value is returned.
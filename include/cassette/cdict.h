@@ -21,8 +21,10 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
+#include "cbloom.h"
 #include "cerr.h"
 
 #if __GNUC__ > 4
@@ -44,9 +46,23 @@ extern "C" {
 /************************************************************************************************************/
 
 /**
- * Opawue dictionary object. It's implemented using the FNV1-A hash function and collisions are resolved using
- * linear probing. A dictionary can automatically grow to maintain a maximum load factor (set by default to
- * 0.6). Values are retrieved using both a NUL terminated string key and a group value.
+ * Opawue dictionary object. Keys are hashed by default with a randomly seeded wyhash function (see enum
+ * cdict_hash for alternatives) and collisions are resolved by default using linear probing over groups of 16
+ * slots (see enum cdict_probing for alternatives). A dictionary can automatically grow to maintain a maximum
+ * load factor (set by default to 0.6). Values are retrieved using both a NUL terminated string key and a
+ * group value. Unless created with the CDICT_STORE_KEYS flag, entries only keep a 64-bit hash of their key
+ * and group, so two different keys with the same hash are treated as the same key.
+ *
+ * Entries are stored next to each other in insertion order, and hashtable slots only hold a 4-byte index into
+ * them, which limits a dictionary to UINT32_MAX entries. Entry hashes, values and groups are kept in separate
+ * arrays so that probes only touch hashes. An entry takes 24 bytes (16 with CDICT_COMPACT_VALUES), plus 5
+ * bytes per hashtable slot, about 8.3 per entry at the default maximum load factor. Erased entries leave
+ * holes that get compacted away once they make up most of the allocated entries. Iterating over a dictionary
+ * walks its entries in order. Once erasures empty it enough, a dictionary also shrinks back on its own (see
+ * cdict_erase()).
+ *
+ * A dictionary can be frozen into a file with cdict_freeze_to_file(), and mapped back read-only with
+ * cdict_open_frozen() to be looked up without being rebuilt or even loaded upfront.
  *
  * Some methods, upon failure, will set an error that can be checked with cdict_error(). If any error is set
  * all string methods will exit early with default return values and no side-effects. It's possible to clear
@@ -54,6 +70,178 @@ extern "C" {
  */
 typedef struct cdict cdict;
 
+/**
+ * Precomputed key and group hash, obtained with cdict_hash(). It can be used with the *_hashed() variants of
+ * cdict functions to avoid rehashing a key that is looked up repeatedly. It's only valid for the dictionary
+ * it has been computed for, or dictionaries that use the same hash function and seed (clones for instance).
+ * It also points to the hashed key, which therefore has to outlive it when used with dictionaries that store
+ * keys. Its fields should not be modified.
+ */
+struct cdict_key
+{
+	uint64_t hash;
+	size_t group;
+	const char *str;
+	size_t length;
+};
+
+/**
+ * Creation-time options, to combine with a bitwise OR and pass to cdict_create_with_flags().
+ *
+ * CDICT_STORE_KEYS : Entries keep a copy of their key, so that keys with the same hash are told apart instead
+ *                    of being treated as the same key. Keys are packed next to each other in a separate
+ *                    arena, and each entry gets 16 more bytes holding the key's length and first 4 bytes.
+ *                    Lookups only read the arena after matching both, and never for keys of 4 bytes or
+ *                    less. The space taken by erased keys is reclaimed when entries get compacted.
+ *
+ * CDICT_INDEX_GROUPS : Entries of a same group are chained together, and a small side table maps each group
+ *                      to its chain. Clearing, counting and iterating over a group then takes time
+ *                      proportional to the group's size instead of the total number of entries, at the cost
+ *                      of 16 more bytes per entry and of keeping chains up to date on writes and erases.
+ *
+ * CDICT_CONCURRENT_READS : cdict_find(), cdict_find_n(), cdict_find_hashed() and cdict_find_batch() can be
+ *                          called from any number of threads while a single other thread modifies the
+ *                          dictionary, without any external lock. Lookups never wait. The dictionary keeps a
+ *                          twin copy, and each lookup goes to whichever of the two is currently in front, only
+ *                          bumping a counter on its own cache line around it. The writer applies a
+ *                          modification to the other copy, puts that one in front, waits for the lookups that
+ *                          may still be on the previous front to end, then applies the modification to it as
+ *                          well. Readers therefore never see a half-updated dictionary, and only the writer
+ *                          ever waits. This doubles the memory taken and the time spent by modifications,
+ *                          which suits dictionaries that are read far more often than written. Other functions
+ *                          must not run concurrently with the writer.
+ *
+ * CDICT_COMPACT_VALUES : Values and groups are stored on 4 bytes instead of the width of size_t, which takes
+ *                        entries from 24 down to 16 bytes on 64-bit machines. Writing a value or group that
+ *                        does not fit in 32 bits then fails with CERR_OVERFLOW.
+ *
+ * CDICT_HUGE_PAGES : Hashtables of 512K slots or more get their arrays from anonymous memory mappings
+ *                    instead of the heap, sized and aligned to 2 MB huge pages. Reserved huge pages are used
+ *                    when the system set some aside, otherwise the kernel is advised to back the mappings with
+ *                    transparent huge pages. Random lookups in large tables then miss the TLB far less often.
+ *                    The fresh mappings also come zeroed without the tables being touched. The hashtables
+ *                    of such dictionaries are always deeply copied by cdict_clone().
+ */
+enum cdict_flag
+{
+	CDICT_STORE_KEYS       = 1 << 0,
+	CDICT_INDEX_GROUPS     = 1 << 1,
+	CDICT_CONCURRENT_READS = 1 << 2,
+	CDICT_COMPACT_VALUES   = 1 << 3,
+	CDICT_HUGE_PAGES       = 1 << 4,
+};
+
+/**
+ * Dictionary entry, as returned by iteration functions. The key is only available in dictionaries created
+ * with the CDICT_STORE_KEYS flag, it is otherwise set to NULL. It is not NUL terminated and stays valid
+ * until the next modification of the dictionary.
+ */
+struct cdict_entry
+{
+	const char *key;
+	size_t length;
+	size_t group;
+	size_t value;
+};
+
+/**
+ * Hash functions used to map keys and groups to slots.
+ *
+ * CDICT_HASH_WY    : Default. Fast 64-bit hash function from the wyhash family that processes keys 8 to 48
+ *                    bytes at a time. Each new dictionary gets its own random seed, which makes collisions
+ *                    hard to provoke from user-supplied keys.
+ *
+ * CDICT_HASH_FNV1A : Byte at a time FNV-1a hash function. Slower on long keys, but its values match other
+ *                    FNV-1a implementations when used with a seed of 0.
+ */
+enum cdict_hash
+{
+	CDICT_HASH_WY = 0,
+	CDICT_HASH_FNV1A,
+};
+
+/**
+ * Collision resolution strategies.
+ *
+ * CDICT_PROBE_GROUPS : Default. Each slot has a 1 byte control tag holding 7 bits of its hash, and tags are
+ *                      kept in their own array so that a whole group of 16 slots can be matched at once (with
+ *                      SSE2 when available). Only the slots with a matching tag are then accessed. Erased
+ *                      slots may leave tombstones behind that lengthen later probes until the next rehash.
+ *
+ * CDICT_PROBE_ROBIN_HOOD : Slot by slot linear probing where an inserted slot takes the place of any slot
+ *                          closer to its home position. Each slot's probe distance is stored in place of the
+ *                          control tag, unsuccessful lookups stop as soon as they meet a closer slot, and
+ *                          erased slots are filled back by shifting the following slots, so no tombstones are
+ *                          ever left behind.
+ *
+ * CDICT_PROBE_PERFECT : For dictionaries that are built once and then only looked up. The current keys get a
+ *                       minimal perfect hash function: they are split into buckets of 2 keys on average, and
+ *                       each bucket is given a 4-byte pilot value, found by trial, that sends each of its keys
+ *                       to a distinct slot. The table then has exactly one slot per key, and a lookup reads
+ *                       one pilot and a single slot without any probing. Erasing keeps this mode, but writing
+ *                       a key that was not part of the build, or preallocating more slots, switches back to
+ *                       CDICT_PROBE_GROUPS. Unlike other modes, switching to this one has no incremental
+ *                       variant and always takes place in one go.
+ *
+ * CDICT_PROBE_CUCKOO : For a bounded worst case lookup. Slots are split in buckets of 4, and each key can only
+ *                      be placed in one of 2 buckets chosen by 2 different hashes, or in a small stash of 8
+ *                      slots at the end of the table, so a lookup never reads more than 16 slots whatever the
+ *                      load. A key inserted in 2 full buckets moves other keys to their alternate buckets,
+ *                      following the shortest chain of such moves, and only falls back to the stash when none
+ *                      is short enough. Insertions get slower with the load, which is capped at 0.9 in this
+ *                      mode. No tombstones are left behind by erased keys. Since keys sharing a same 64-bit
+ *                      hash also share their buckets, no more than 16 of them fit, and writing more fails
+ *                      with CERR_OVERFLOW.
+ */
+enum cdict_probing
+{
+	CDICT_PROBE_GROUPS = 0,
+	CDICT_PROBE_ROBIN_HOOD,
+	CDICT_PROBE_PERFECT,
+	CDICT_PROBE_CUCKOO,
+};
+
+/**
+ * Number of buckets in the probe length histogram of struct cdict_stats.
+ */
+#define CDICT_STATS_PROBES 16
+
+/**
+ * Dictionary statistics, as returned by cdict_stats(). Probe lengths and displacements cover every key
+ * currently in the dictionary, including those of the old hashtable during an incremental resize.
+ *
+ * probes            : Histogram of the number of probing steps needed to find each key (see
+ *                     cdict_probe_length()), probes[i] counts keys found in i + 1 steps, and the last
+ *                     bucket also counts all longer probes
+ * probes_max        : Longest probe
+ * probes_mean       : Average probe length
+ * displacement_max  : Greatest distance, in slots, between a key's slot and its home slot. In
+ *                     CDICT_PROBE_CUCKOO mode, it is counted in buckets instead
+ * displacement_mean : Average distance, in slots, between a key's slot and its home slot, or in buckets in
+ *                     CDICT_PROBE_CUCKOO mode
+ * tombstones        : Number of erased slots still marked as such, in CDICT_PROBE_GROUPS mode
+ * bytes             : Memory taken by the dictionary, or the size of the mapped file for a frozen one
+ * grows             : Number of times the hashtable grew, from writes or cdict_prealloc()
+ * grow_time         : Total time spent growing the hashtable, in seconds. With incremental resizing, only
+ *                     the allocation and first step of each resize are included
+ * hits              : Estimated number of successful lookups, 0 unless enabled with cdict_set_sampling()
+ * misses            : Estimated number of failed lookups, 0 unless enabled with cdict_set_sampling()
+ */
+struct cdict_stats
+{
+	size_t probes[CDICT_STATS_PROBES];
+	size_t probes_max;
+	double probes_mean;
+	size_t displacement_max;
+	double displacement_mean;
+	size_t tombstones;
+	size_t bytes;
+	size_t grows;
+	double grow_time;
+	size_t hits;
+	size_t misses;
+};
+
 /************************************************************************************************************/
 /* GLOBALS **************************************************************************************************/
 /************************************************************************************************************/
@@ -76,7 +264,20 @@ extern cdict cdict_placeholder_instance;
 /************************************************************************************************************/
 
 /**
- * Create a dictionary instance and deep copy the contents of another dictionary instance into it.
+ * Create a dictionary instance and copy the contents of another dictionary instance into it. Arrays of 256 KB
+ * or more are not copied but shared. The first time such an array gets cloned, it moves into a memory file
+ * that all dictionaries of the process share, and whose 4 KB pages count the arrays that show them. The source
+ * maps the pages privately in place of its array, and the clone maps the same pages privately at another
+ * address, so the kernel only copies a page, once, when either side writes to it. Memory then grows with the
+ * pages that diverge. Later clones cost a few mappings and per page counter updates, plus storing the pages
+ * the source wrote to since it was last cloned, which are found through /proc/self/pagemap on Linux, while
+ * other systems store the whole arrays again. The source can be read from other threads meanwhile. Arrays that
+ * grow, like the hashtable when it reaches its maximum load factor, are reallocated whole. Hashtables of
+ * dictionaries created with CDICT_HUGE_PAGES, arrays of frozen dictionaries, and every array on systems
+ * without shared memory objects, are deep copied. The memory file takes a single file descriptor, until no
+ * dictionary maps it anymore. A forked child process moves the arrays it clones to a file of its own, and
+ * leaves the pages it inherited to its parent. A Bloom filter attached to the source is not attached to the
+ * clone.
  *
  * @param dict : Dictionary to copy contents from
  *
@@ -99,7 +300,36 @@ cdict_create(void)
 CDICT_NONNULL_RETURN;
 
 /**
- * Destroys the given dictionary and frees memory.
+ * Same as cdict_create(), but with creation-time options that cannot be changed later on.
+ *
+ * @param flags : Bitwise OR of enum cdict_flag values
+ *
+ * @return     : New dictionary instance
+ * @return_err : CDICT_PLACEHOLDER, also returned if unknown flags are given
+ */
+cdict *
+cdict_create_with_flags(unsigned int flags)
+CDICT_NONNULL_RETURN;
+
+/**
+ * Same as cdict_create(), but each entry holds a payload of the given size instead of a size_t value. The
+ * payloads are stored inline in the dictionary's value array, like plain values, so a lookup reaches them
+ * without going through a second array. They are written with cdict_write_ref() and read in place with
+ * cdict_find_ref(). Payloads are 8-byte aligned when their size is a multiple of 8. Functions that take a
+ * size_t value, like cdict_write(), zero the payload of the key instead, and functions that give one back
+ * give 0.
+ *
+ * @param bytes : Size of each payload, must not be 0
+ *
+ * @return     : New dictionary instance
+ * @return_err : CDICT_PLACEHOLDER
+ */
+cdict *
+cdict_create_with_value_size(size_t bytes)
+CDICT_NONNULL_RETURN;
+
+/**
+ * Destroys the given dictionary and frees memory. Frozen dictionaries get unmapped.
  *
  * @param dict : Dictionary to interact with
  */
@@ -107,12 +337,74 @@ void
 cdict_destroy(cdict *dict)
 CDICT_NONNULL(1);
 
+/**
+ * Maps a frozen image written by cdict_freeze_to_file() read-only into memory and returns a dictionary that
+ * looks keys up straight from the mapping. Nothing is parsed or copied, pages are read on demand and shared
+ * through the page cache by all processes that map the same file. A frozen dictionary cannot be modified,
+ * functions that would do so have no effect, but it can be cloned into a regular dictionary. Since it never
+ * changes, it can be looked up from any number of threads at once. Beyond its header and size, the image is
+ * trusted and not checked.
+ *
+ * @param path : Path of the image file
+ *
+ * @return     : New dictionary instance
+ * @return_err : CDICT_PLACEHOLDER, also returned if the file cannot be mapped, or is not an image of the same
+ *               format version written on a machine with the same byte order and size_t width
+ */
+cdict *
+cdict_open_frozen(const char *path)
+CDICT_NONNULL_RETURN
+CDICT_NONNULL(1);
+
 /************************************************************************************************************/
 /* IMPURE METHODS *******************************************************************************************/
 /************************************************************************************************************/
 
 /**
- * Clears all active slots. Allocated memory is not freed, use cdict_destroy() for that.
+ * Convenience for-loop wrapper over all entries. ENTRY must be a struct cdict_entry variable, and the
+ * dictionary must not be modified inside the loop.
+ */
+#define CDICT_FOR_EACH(DICT, I, ENTRY) \
+	for (size_t I = 0; cdict_next(DICT, &I, &ENTRY);)
+
+/**
+ * Convenience for-loop wrapper over the entries of a group. ENTRY must be a struct cdict_entry variable, and
+ * the dictionary must not be modified inside the loop.
+ */
+#define CDICT_FOR_EACH_IN_GROUP(DICT, GROUP, I, ENTRY) \
+	for (size_t I = 0; cdict_next_in_group(DICT, GROUP, &I, &ENTRY);)
+
+/**
+ * Writes n keys at once, with the same result as successive calls to cdict_write() in the same order. Empty
+ * dictionaries are built in parallel: the hashtable and entry arrays get sized for the n keys upfront, so
+ * that they never grow, then keys are split in slices hashed by different threads, and the hashtable in as
+ * many ranges of slots, each filled by its own thread with the keys whose home slot falls in it. Keys that
+ * would overflow past the end of their range, and duplicates, are settled by the calling thread afterwards.
+ * Each thread gets at least a few thousand keys, so small batches use fewer threads than requested. Tables
+ * in CDICT_PROBE_ROBIN_HOOD or CDICT_PROBE_CUCKOO mode only get hashed and filled in parallel, and tables in
+ * CDICT_PROBE_PERFECT mode are rebuilt in it once all keys are in. Keys of dictionaries that are not empty
+ * are written one by one.
+ *
+ * @param dict    : Dictionary to interact with
+ * @param keys    : Array of n keys to write
+ * @param groups  : Array of n groups to write
+ * @param values  : Array of n values to write
+ * @param n       : Number of keys
+ * @param threads : Maximum number of threads to use, including the calling thread, 0 is the same as 1
+ *
+ * @error CERR_OVERFLOW : The size of the resulting dictionary will be > SIZE_MAX, it would hold more than
+ *                        UINT32_MAX entries, the dictionary stores keys and a key is longer than 4GB, or
+ *                        the dictionary has compact values and a value or group is > UINT32_MAX
+ * @error CERR_MEMORY   : Failed memory allocation
+ */
+void
+cdict_build(cdict *dict, const char *const *keys, const size_t *groups, const size_t *values, size_t n,
+            size_t threads)
+CDICT_NONNULL(1, 2, 3, 4);
+
+/**
+ * Clears all active slots. Allocated memory is not freed, use cdict_shrink_to_fit() or cdict_destroy() for
+ * that.
  *
  * @param dict : Dictionary to interact with
  */
@@ -121,7 +413,9 @@ cdict_clear(cdict *dict)
 CDICT_NONNULL(1);
 
 /**
- * Clears all active slots of a specific group. Allocated memory is not freed, use cdict_destroy() for that.
+ * Clears all active slots of a specific group. This takes time proportional to the group's size in
+ * dictionaries created with the CDICT_INDEX_GROUPS flag, and to the number of entries otherwise. The
+ * dictionary may shrink afterwards, like after cdict_erase().
  *
  * @param dict  : Dictionary to interact with
  * @param group : Group to match
@@ -132,7 +426,13 @@ CDICT_NONNULL(1);
 
 /**
  * Deletes the slot that matches the given key and group. This function has no effect if there are no matching
- * slots. Allocated memory is not freed, use cdict_destroy() for that.
+ * slots. Once erasures bring the load factor under a quarter of the maximum load factor, the hashtable shrinks
+ * to get back to half of it, and entries and keys get compacted into smaller arrays. The gap between both
+ * thresholds keeps a dictionary that hovers around a size from being resized back and forth. It never shrinks
+ * below a size requested with cdict_prealloc(). In CDICT_PROBE_GROUPS mode, erased slots can also linger as
+ * tombstones that lengthen probes, and they get swept in place, without allocating a new hashtable, once they
+ * take up more than a quarter of the maximum load factor. Both take time proportional to the number of entries
+ * but happen rarely enough to only add a constant amortized cost per erasure.
  *
  * @param dict  : Dictionary to interact with
  * @param key   : Key to match
@@ -142,25 +442,125 @@ void
 cdict_erase(cdict *dict, const char *key, size_t group)
 CDICT_NONNULL(1, 2);
 
+/**
+ * Same as cdict_erase(), but with a precomputed key and group hash.
+ *
+ * @param dict : Dictionary to interact with
+ * @param key  : Precomputed key and group hash to match
+ */
+void
+cdict_erase_hashed(cdict *dict, struct cdict_key key)
+CDICT_NONNULL(1);
+
+/**
+ * Same as cdict_erase(), but with a key of explicit length that does not need to be NUL terminated.
+ *
+ * @param dict   : Dictionary to interact with
+ * @param key    : Key to match
+ * @param length : Key length in bytes
+ * @param group  : Group to match
+ */
+void
+cdict_erase_n(cdict *dict, const char *key, size_t length, size_t group)
+CDICT_NONNULL(1, 2);
+
+/**
+ * Adds the hashes of all keys of the dictionary to a Bloom filter, in a single pass over the hashes the
+ * dictionary already stores, so that no key gets hashed again. Frozen dictionaries can be used as well. Sizing
+ * the filter for cdict_load() hashes, or more if keys will be written later, keeps its false positive rate
+ * as expected.
+ *
+ * @param dict  : Dictionary to interact with
+ * @param bloom : Bloom filter to fill
+ */
+void
+cdict_fill_bloom(const cdict *dict, cbloom *bloom)
+CDICT_NONNULL(1, 2);
+
+/**
+ * Moves all remaining slots of an ongoing incremental resize (see cdict_set_resize_step()) into the new
+ * hashtable and frees the old one. This function has no effect if there are no ongoing resizes.
+ *
+ * @param dict : Dictionary to interact with
+ */
+void
+cdict_finish_resize(cdict *dict)
+CDICT_NONNULL(1);
+
+/**
+ * Writes a frozen image of the dictionary into a file, to be mapped back with cdict_open_frozen(). The image
+ * holds the hashtable, entries and stored keys exactly as they are laid out in memory, with offsets instead of
+ * pointers, so it can be used as is once mapped. Erased entries and ongoing resizes are first dealt with in a
+ * temporary copy if needed, and chains of CDICT_INDEX_GROUPS are left out. The image is written to a
+ * temporary file next to the given path, then renamed over it, so that processes that have mapped a previous
+ * image keep seeing it whole.
+ *
+ * @param dict : Dictionary to interact with
+ * @param path : Path of the image file
+ *
+ * @return     : true on success
+ * @return_err : false, also returned if the file cannot be created or written
+ */
+bool
+cdict_freeze_to_file(const cdict *dict, const char *path)
+CDICT_NONNULL(1, 2);
+
 /** 
  * Preallocates a set amount of slots to avoid triggering multiple automatic reallocs and rehashes when adding
  * data to the dictionary. To stay under the set maximum load factor (default = 0.6), the actual amount of
  * allocated hashtable slots is slot_number / max_load_factor. This function has no effect if the requested
- * number of slots is smaller than the previously allocated amount.
+ * number of slots is smaller than the previously allocated amount. Erasures never shrink the dictionary
+ * below the preallocated size, unless cdict_shrink_to_fit() gets called.
  *
  * @param dict         : Dictionary to interact with
  * @param slots_number : Number of slots
  *
- * @error CERR_OVERFLOW : The size of the resulting dictionary will be > SIZE_MAX
+ * @error CERR_OVERFLOW : The size of the resulting dictionary will be > SIZE_MAX, or slots_number > UINT32_MAX
  * @error CERR_MEMORY   : Failed memory allocation
  */
 void
 cdict_prealloc(cdict *dict, size_t slots_number)
 CDICT_NONNULL(1);
 
+/**
+ * Attaches a Bloom filter to the dictionary, or detaches the current one if bloom is NULL. While attached,
+ * lookups first test the filter and only probe the hashtable if it may hold their key, so that most missing
+ * keys are answered after touching a single cache line. The filter must already hold the hashes of all keys
+ * of the dictionary, see cdict_fill_bloom(), and keys written afterwards get added to it. Erased keys stay
+ * in the filter and only raise its false positive rate. The dictionary does not own the filter, which must
+ * outlive the attachment and must not be modified by anything else while the dictionary is in use. Frozen
+ * dictionaries can take a filter too. With CDICT_CONCURRENT_READS, the twin copy of the dictionary attaches
+ * its own copy of the filter, so that the writer never modifies a filter that lookups are testing.
+ *
+ * @param dict  : Dictionary to interact with
+ * @param bloom : Bloom filter to attach, or NULL
+ *
+ * @error CERR_PARAM  : The Bloom filter is invalid
+ * @error CERR_MEMORY : Failed memory allocation
+ */
+void
+cdict_set_bloom(cdict *dict, cbloom *bloom)
+CDICT_NONNULL(1);
+
+/**
+ * Selects the hash function and its seed. Because slots only keep the hash of their keys, this can only be
+ * done while the dictionary is empty. Default value = CDICT_HASH_WY with a random seed.
+ *
+ * @param dict : Dictionary to interact with
+ * @param hash : Hash function to use
+ * @param seed : Seed to use, giving the same seed to different dictionaries makes them hash keys the same way
+ *
+ * @error CERR_PARAM : Illegal hash value was given or the dictionary is not empty
+ */
+void
+cdict_set_hash(cdict *dict, enum cdict_hash hash, uint64_t seed)
+CDICT_NONNULL(1);
+
 /**
  * Sets the maximum load factor. To stay under it, the dictionary may automatically extend its number of
- * allocated slots. Default value = 0.6. Values outside of the [0.0 1.0], 0.0 excluded, are illegal.
+ * allocated slots. Default value = 0.6. Values outside of the [0.0 1.0], 0.0 excluded, are illegal. Tables
+ * in CDICT_PROBE_PERFECT mode stay full, the load factor only applies once they switch back to another mode.
+ * In CDICT_PROBE_CUCKOO mode, values above 0.9 are lowered to 0.9.
  *
  * @param dict        : Dictionary to interact with
  * @param load_factor : Maximum load factor to set
@@ -173,9 +573,75 @@ void
 cdict_set_max_load(cdict *dict, double load_factor)
 CDICT_NONNULL(1);
 
+/**
+ * Changes the collision resolution strategy. All active slots get rehashed into a newly allocated hashtable
+ * of the same size, or, when switching to CDICT_PROBE_PERFECT, of exactly as many slots as there are keys.
+ * When switching out of CDICT_PROBE_PERFECT, the new hashtable is sized for the maximum load factor instead.
+ * Switching to CDICT_PROBE_CUCKOO lowers the maximum load factor to 0.9 if it was above, and grows the
+ * hashtable if needed to respect it. Default value = CDICT_PROBE_GROUPS.
+ *
+ * @param dict    : Dictionary to interact with
+ * @param probing : Collision resolution strategy to use
+ *
+ * @error CERR_OVERFLOW : There are more than 2^31 keys to give a perfect hash function to
+ * @error CERR_MEMORY   : Failed memory allocation
+ * @error CERR_PARAM    : Illegal probing value was given, or two stored keys share the same 64-bit hash
+ */
+void
+cdict_set_probing(cdict *dict, enum cdict_probing probing)
+CDICT_NONNULL(1);
+
+/**
+ * Enables incremental resizing. Instead of rehashing all slots at once when the dictionary grows, a new
+ * hashtable is allocated next to the old one, and every following call to cdict_write() or cdict_erase()
+ * moves at most slots_number slots of the old hashtable into the new one. Until the resize is complete,
+ * lookups check both hashtables. Shrinking and sweeping tombstones after erasures then also go through a new
+ * hashtable instead of being done in place. Slots_number = 0 disables incremental resizing and completes any
+ * ongoing resize immediately. Default value = 0.
+ *
+ * @param dict         : Dictionary to interact with
+ * @param slots_number : Maximum number of old hashtable slots to move per operation
+ */
+void
+cdict_set_resize_step(cdict *dict, size_t slots_number)
+CDICT_NONNULL(1);
+
+/**
+ * Counts the outcome of one in every period lookups of the dictionary, to estimate the number of successful
+ * and failed lookups reported by cdict_stats(). Lookups are ticked on per-thread counters that belong to the
+ * dictionary, and sampled dictionaries do not affect each other. The outcome counters are shared by all
+ * threads but only written to by sampled lookups, so a large enough period keeps their cost negligible even
+ * with CDICT_CONCURRENT_READS, where the twin copy samples the lookups made while it is in front on its own
+ * counters. Counters are reset by each call. Clones get their own counters with the same period. Default
+ * value = 0, which disables sampling.
+ *
+ * @param dict   : Dictionary to interact with
+ * @param period : Number of lookups per sampled lookup, or 0
+ *
+ * @error CERR_MEMORY : Failed memory allocation
+ */
+void
+cdict_set_sampling(cdict *dict, size_t period)
+CDICT_NONNULL(1);
+
+/**
+ * Shrinks the hashtable down to the smallest size that keeps it under the maximum load factor, and compacts
+ * entries and keys into arrays that fit them exactly. The hashtable is rebuilt in place, and arrays are only
+ * shrunk with realloc(), so no second copy of the dictionary is ever allocated. Any ongoing incremental
+ * resize is completed first, and the size requested by earlier cdict_prealloc() calls is forgotten. In
+ * CDICT_PROBE_PERFECT mode, the hashtable is already full and only entries get compacted. This takes time
+ * proportional to the number of entries.
+ *
+ * @param dict : Dictionary to interact with
+ */
+void
+cdict_shrink_to_fit(cdict *dict)
+CDICT_NONNULL(1);
+
 /** 
  * Clears errors and puts the dictionary back into an usable state. The only unrecoverable error is
- * CDICT_INVALID.
+ * CDICT_INVALID. With CDICT_CONCURRENT_READS, the twin copy is copied again from the dictionary when a
+ * modification failed on only one of the two.
  *
  * @param dict : Dictionary to interact with
  */
@@ -194,13 +660,68 @@ CDICT_NONNULL(1);
  * @param group : Group to match
  * @param value : Value to associate with the slot
  *
- * @error CERR_OVERFLOW : The size of the resulting dictionary will be > SIZE_MAX
+ * @error CERR_OVERFLOW : The size of the resulting dictionary will be > SIZE_MAX, it would hold more than
+ *                        UINT32_MAX entries, the dictionary stores keys and the key is longer than 4GB,
+ *                        or the dictionary has compact values and the value or group is > UINT32_MAX
  * @error CERR_MEMORY   : Failed memory allocation
  */
 void
 cdict_write(cdict *dict, const char *key, size_t group, size_t value)
 CDICT_NONNULL(1, 2);
 
+/**
+ * Same as cdict_write(), but with a precomputed key and group hash.
+ *
+ * @param dict  : Dictionary to interact with
+ * @param key   : Precomputed key and group hash to match
+ * @param value : Value to associate with the slot
+ *
+ * @error CERR_OVERFLOW : The size of the resulting dictionary will be > SIZE_MAX, it would hold more than
+ *                        UINT32_MAX entries, the dictionary stores keys and the key is longer than 4GB,
+ *                        or the dictionary has compact values and the value or group is > UINT32_MAX
+ * @error CERR_MEMORY   : Failed memory allocation
+ */
+void
+cdict_write_hashed(cdict *dict, struct cdict_key key, size_t value)
+CDICT_NONNULL(1);
+
+/**
+ * Same as cdict_write(), but with a key of explicit length that does not need to be NUL terminated.
+ *
+ * @param dict   : Dictionary to interact with
+ * @param key    : Key to match
+ * @param length : Key length in bytes
+ * @param group  : Group to match
+ * @param value  : Value to associate with the slot
+ *
+ * @error CERR_OVERFLOW : The size of the resulting dictionary will be > SIZE_MAX, it would hold more than
+ *                        UINT32_MAX entries, the dictionary stores keys and the key is longer than 4GB,
+ *                        or the dictionary has compact values and the value or group is > UINT32_MAX
+ * @error CERR_MEMORY   : Failed memory allocation
+ */
+void
+cdict_write_n(cdict *dict, const char *key, size_t length, size_t group, size_t value)
+CDICT_NONNULL(1, 2);
+
+/**
+ * Same as cdict_write(), but copies the value in from a pointer. In dictionaries created with
+ * cdict_create_with_value_size(), it copies a whole payload. Otherwise it copies a size_t, or a uint32_t in
+ * dictionaries with compact values.
+ *
+ * @param dict  : Dictionary to interact with
+ * @param key   : Key to match
+ * @param group : Group to match
+ * @param value : Value to copy into the slot
+ *
+ * @error CERR_OVERFLOW : The size of the resulting dictionary will be > SIZE_MAX, it would hold more than
+ *                        UINT32_MAX entries, the dictionary stores keys and the key is longer than 4GB,
+ *                        or the dictionary has compact values and the group is > UINT32_MAX
+ * @error CERR_MEMORY   : Failed memory allocation
+ */
+void
+cdict_write_ref(cdict *dict, const char *key, size_t group, const void *value)
+CDICT_NONNULL(1, 2, 4);
+
 /************************************************************************************************************/
 /* PURE METHODS *********************************************************************************************/
 /************************************************************************************************************/
@@ -233,6 +754,106 @@ bool
 cdict_find(const cdict *dict, const char *key, size_t group, size_t *value)
 CDICT_NONNULL(1, 2);
 
+/**
+ * Looks up a batch of keys and groups at once. Keys get hashed and their home slots prefetched a few at a
+ * time before being probed, so that the cache misses of different lookups overlap instead of adding up. This
+ * is notably faster than successive calls to cdict_find() on dictionaries that do not fit in the CPU cache.
+ * For each key, if the optional values and found arrays are not NULL, the associated value of the found slot
+ * and the match result get written at the same index.
+ *
+ * @param dict   : Dictionary to interact with
+ * @param keys   : Array of n keys to match
+ * @param groups : Array of n groups to match
+ * @param n      : Number of keys
+ * @param values : Optional parameter, array of n values associated to the found slots
+ * @param found  : Optional parameter, array of n slot matches
+ *
+ * @return     : Number of slot matches
+ * @return_err : 0
+ */
+size_t
+cdict_find_batch(const cdict *dict, const char *const *keys, const size_t *groups, size_t n, size_t *values,
+                 bool *found)
+CDICT_NONNULL(1, 2, 3);
+
+/**
+ * Same as cdict_find(), but with a precomputed key and group hash.
+ *
+ * @param dict  : Dictionary to interact with
+ * @param key   : Precomputed key and group hash to match
+ * @param value : Optional parameter, value associated to the found slot
+ *
+ * @return     : Slot match
+ * @return_err : false
+ */
+bool
+cdict_find_hashed(const cdict *dict, struct cdict_key key, size_t *value)
+CDICT_NONNULL(1);
+
+/**
+ * Same as cdict_find(), but with a key of explicit length that does not need to be NUL terminated.
+ *
+ * @param dict   : Dictionary to interact with
+ * @param key    : Key to match
+ * @param length : Key length in bytes
+ * @param group  : Group to match
+ * @param value  : Optional parameter, value associated to the found slot
+ *
+ * @return     : Slot match
+ * @return_err : false
+ */
+bool
+cdict_find_n(const cdict *dict, const char *key, size_t length, size_t group, size_t *value)
+CDICT_NONNULL(1, 2);
+
+/**
+ * Same as cdict_find(), but gives a pointer to the value held by the found slot instead of a copy. In
+ * dictionaries created with cdict_create_with_value_size(), it points to the payload, otherwise to the
+ * size_t value, or its uint32_t equivalent in dictionaries with compact values. The pointer stays valid
+ * until the next modification of the dictionary, and its data must only be changed with cdict_write_ref().
+ *
+ * @param dict  : Dictionary to interact with
+ * @param key   : Key to match
+ * @param group : Group to match
+ *
+ * @return     : Pointer to the value of the found slot, NULL if there are none
+ * @return_err : NULL
+ */
+const void *
+cdict_find_ref(const cdict *dict, const char *key, size_t group)
+CDICT_NONNULL(1, 2);
+
+/**
+ * Gets the number of active slots of a specific group. This takes time proportional to the group's size in
+ * dictionaries created with the CDICT_INDEX_GROUPS flag, and to the number of entries otherwise.
+ *
+ * @param dict  : Dictionary to interact with
+ * @param group : Group to match
+ *
+ * @return     : Number of slots
+ * @return_err : 0
+ */
+size_t
+cdict_group_length(const cdict *dict, size_t group)
+CDICT_NONNULL(1)
+CDICT_PURE;
+
+/**
+ * Computes the hash of a key and group with the dictionary's hash function and seed. The result can be
+ * passed to the *_hashed() variants of cdict functions. The key does not need to be NUL terminated.
+ *
+ * @param dict   : Dictionary to interact with
+ * @param key    : Key to hash
+ * @param length : Key length in bytes
+ * @param group  : Group to hash
+ *
+ * @return : Precomputed key and group hash
+ */
+struct cdict_key
+cdict_hash(const cdict *dict, const char *key, size_t length, size_t group)
+CDICT_NONNULL(1, 2)
+CDICT_PURE;
+
 /**
  * Gets the number of active slots.
  *
@@ -259,6 +880,89 @@ cdict_load_factor(const cdict *dict)
 CDICT_NONNULL(1)
 CDICT_PURE;
 
+/**
+ * Iterates over all entries in insertion order. The iterator must be set to 0 before the first call, and then
+ * be passed back unchanged. Each call writes the next entry into the entry parameter and returns true, until
+ * there are none left. Overwriting the value of an existing key keeps its position. Modifying the dictionary
+ * invalidates the iterator.
+ *
+ * @param dict     : Dictionary to interact with
+ * @param iterator : Iteration state
+ * @param entry    : Next entry
+ *
+ * @return     : Entry match
+ * @return_err : false
+ */
+bool
+cdict_next(const cdict *dict, size_t *iterator, struct cdict_entry *entry)
+CDICT_NONNULL(1, 2, 3);
+
+/**
+ * Same as cdict_next(), but only iterates over the entries of a specific group. In dictionaries created with
+ * the CDICT_INDEX_GROUPS flag, a whole iteration takes time proportional to the group's size, and to the
+ * number of entries otherwise.
+ *
+ * @param dict     : Dictionary to interact with
+ * @param group    : Group to match
+ * @param iterator : Iteration state
+ * @param entry    : Next entry of the group
+ *
+ * @return     : Entry match
+ * @return_err : false
+ */
+bool
+cdict_next_in_group(const cdict *dict, size_t group, size_t *iterator, struct cdict_entry *entry)
+CDICT_NONNULL(1, 3, 4);
+
+/**
+ * Gets the number of probing steps needed to find the slot that matches the given key and group, or to
+ * conclude that there are none. In the default CDICT_PROBE_GROUPS mode, a step covers a whole group of 16
+ * slots, in CDICT_PROBE_CUCKOO mode it covers a bucket or the stash, so there are at most 3 steps, otherwise
+ * it covers a single slot. This is mostly meant to evaluate the effects of the dictionary's
+ * settings and usage patterns on its performance.
+ *
+ * @param dict  : Dictionary to interact with
+ * @param key   : Key to match
+ * @param group : Group to match
+ *
+ * @return     : Number of probing steps
+ * @return_err : 0
+ */
+size_t
+cdict_probe_length(const cdict *dict, const char *key, size_t group)
+CDICT_NONNULL(1, 2)
+CDICT_PURE;
+
+/**
+ * Gets the progress of an ongoing incremental resize, as the ratio of old hashtable slots that have already
+ * been moved into the new one.
+ *
+ * @param dict : Dictionary to interact with
+ *
+ * @return     : 0.0 to 1.0 ratio, 1.0 if there are no ongoing resizes
+ * @return_err : 1.0
+ */
+double
+cdict_resize_progress(const cdict *dict)
+CDICT_NONNULL(1)
+CDICT_PURE;
+
+/**
+ * Gathers statistics about the dictionary's hashtable and memory use, to be exported as metrics or to tune
+ * its maximum load factor. Probe lengths and displacements are computed by walking the whole hashtable, so
+ * this takes time proportional to the number of allocated slots. It can be called concurrently with lookups
+ * in dictionaries created with the CDICT_CONCURRENT_READS flag, whose twin copy is included in the memory use
+ * and sampled lookups.
+ *
+ * @param dict : Dictionary to interact with
+ *
+ * @return     : Statistics
+ * @return_err : Statistics with every field set to 0
+ */
+struct cdict_stats
+cdict_stats(const cdict *dict)
+CDICT_NONNULL(1);
+
 /************************************************************************************************************/
 /************************************************************************************************************/
 /************************************************************************************************************/
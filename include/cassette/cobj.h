@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include "cbloom.h"
 #include "cbook.h"
 #include "ccolor.h"
 #include "cdict.h"
@@ -28,4 +29,6 @@
 #include "crand.h"
 #include "cref.h"
 #include "cseg.h"
+#include "cshard.h"
 #include "cstr.h"
+#include "ctrie.h"
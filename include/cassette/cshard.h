@@ -0,0 +1,377 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "cdict.h"
+#include "cerr.h"
+
+#if __GNUC__ > 4
+	#define CSHARD_NONNULL_RETURN __attribute__((returns_nonnull))
+	#define CSHARD_NONNULL(...)   __attribute__((nonnull (__VA_ARGS__)))
+	#define CSHARD_PURE           __attribute__((pure))
+#else
+	#define CSHARD_NONNULL_RETURN
+	#define CSHARD_NONNULL(...)
+	#define CSHARD_PURE
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/************************************************************************************************************/
+/* TYPES ****************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Opaque sharded dictionary object, meant to be written to by many threads at once. The key space is split
+ * into a power of two number of shards by the hash bits right under the 7 high bits cdict keeps as control
+ * tags, and each shard is an independent cdict guarded by its own mutex. Threads working on different shards
+ * never wait for each other, and each shard grows on its own, so that a resize only stalls the threads that
+ * access that shard. All shards share the same hash function and seed, so a key is only hashed once, outside
+ * of any lock.
+ *
+ * All functions but cshard_destroy() can be called concurrently. Functions that span all shards, like
+ * cshard_clear_group() or cshard_load(), lock them one after the other, so they do not see or act on all of
+ * them at the exact same time.
+ *
+ * Errors raised by a shard's dictionary only disable that shard, and can be checked with cshard_error() and
+ * cleared with cshard_repair(). If the sharded dictionary itself is invalid, all methods will exit early with
+ * default return values and no side-effects.
+ */
+typedef struct cshard cshard;
+
+/************************************************************************************************************/
+/* GLOBALS **************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * A macro that gives uninitialized sharded dictionaries a non-NULL value that is safe to use with the sharded
+ * dictionary's related functions. However, any function called with a handle set to this value will return
+ * early and without any side effects.
+ */
+#define CSHARD_PLACEHOLDER (&cshard_placeholder_instance)
+
+/**
+ * Global sharded dictionary instance with the error state set to CERR_INVALID. This instance is made
+ * available to allow the static initialization of sharded dictionary pointers with the macro
+ * CSHARD_PLACEHOLDER.
+ */
+extern cshard cshard_placeholder_instance;
+
+/************************************************************************************************************/
+/* CONSTRUCTORS / DESTRUCTORS *******************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Creates an empty sharded dictionary. The number of shards gets rounded up to the next power of two, and
+ * a few times the number of writing threads is a good starting point.
+ *
+ * @param shards_number : Number of shards, from 1 to 4096
+ *
+ * @return     : New sharded dictionary instance
+ * @return_err : CSHARD_PLACEHOLDER, also returned if shards_number is out of range
+ */
+cshard *
+cshard_create(size_t shards_number)
+CSHARD_NONNULL_RETURN;
+
+/**
+ * Same as cshard_create(), but with creation-time options given to every shard's dictionary.
+ *
+ * @param shards_number : Number of shards, from 1 to 4096
+ * @param flags         : Bitwise OR of enum cdict_flag values
+ *
+ * @return     : New sharded dictionary instance
+ * @return_err : CSHARD_PLACEHOLDER, also returned if shards_number is out of range or unknown flags are given
+ */
+cshard *
+cshard_create_with_flags(size_t shards_number, unsigned int flags)
+CSHARD_NONNULL_RETURN;
+
+/**
+ * Destroys the given sharded dictionary and frees memory. No other thread may still be using it.
+ *
+ * @param shard : Sharded dictionary to interact with
+ */
+void
+cshard_destroy(cshard *shard)
+CSHARD_NONNULL(1);
+
+/************************************************************************************************************/
+/* IMPURE METHODS *******************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Clears all active slots of all shards. Allocated memory is not freed, use cshard_destroy() for that.
+ *
+ * @param shard : Sharded dictionary to interact with
+ */
+void
+cshard_clear(cshard *shard)
+CSHARD_NONNULL(1);
+
+/**
+ * Clears all active slots of a specific group in all shards. Allocated memory is not freed, use
+ * cshard_destroy() for that.
+ *
+ * @param shard : Sharded dictionary to interact with
+ * @param group : Group to match
+ */
+void
+cshard_clear_group(cshard *shard, size_t group)
+CSHARD_NONNULL(1);
+
+/**
+ * Deletes the slot that matches the given key and group. This function has no effect if there are no matching
+ * slots. Only the shard the key maps to is locked.
+ *
+ * @param shard : Sharded dictionary to interact with
+ * @param key   : Key to match
+ * @param group : Group to match
+ */
+void
+cshard_erase(cshard *shard, const char *key, size_t group)
+CSHARD_NONNULL(1, 2);
+
+/**
+ * Same as cshard_erase(), but with a precomputed key and group hash.
+ *
+ * @param shard : Sharded dictionary to interact with
+ * @param key   : Precomputed key and group hash to match
+ */
+void
+cshard_erase_hashed(cshard *shard, struct cdict_key key)
+CSHARD_NONNULL(1);
+
+/**
+ * Same as cshard_erase(), but with a key of explicit length that does not need to be NUL terminated.
+ *
+ * @param shard  : Sharded dictionary to interact with
+ * @param key    : Key to match
+ * @param length : Key length in bytes
+ * @param group  : Group to match
+ */
+void
+cshard_erase_n(cshard *shard, const char *key, size_t length, size_t group)
+CSHARD_NONNULL(1, 2);
+
+/**
+ * Preallocates a set amount of slots, spread evenly over all shards, to avoid triggering multiple automatic
+ * reallocs and rehashes when adding data to the sharded dictionary. See cdict_prealloc().
+ *
+ * @param shard        : Sharded dictionary to interact with
+ * @param slots_number : Total number of slots
+ *
+ * @error CERR_OVERFLOW : The size of a resulting shard will be > SIZE_MAX
+ * @error CERR_MEMORY   : Failed memory allocation
+ */
+void
+cshard_prealloc(cshard *shard, size_t slots_number)
+CSHARD_NONNULL(1);
+
+/**
+ * Clears the errors of all shards and puts them back into an usable state.
+ *
+ * @param shard : Sharded dictionary to interact with
+ */
+void
+cshard_repair(cshard *shard)
+CSHARD_NONNULL(1);
+
+/**
+ * Activates a slot in the shard the key maps to, see cdict_write(). Only that shard is locked, including
+ * while it grows.
+ *
+ * @param shard : Sharded dictionary to interact with
+ * @param key   : Key to match
+ * @param group : Group to match
+ * @param value : Value to associate with the slot
+ *
+ * @error CERR_OVERFLOW : The size of the resulting shard will be > SIZE_MAX, it would hold more than
+ *                        UINT32_MAX entries, or the shards store keys and the key is longer than 4GB
+ * @error CERR_MEMORY   : Failed memory allocation
+ */
+void
+cshard_write(cshard *shard, const char *key, size_t group, size_t value)
+CSHARD_NONNULL(1, 2);
+
+/**
+ * Same as cshard_write(), but with a precomputed key and group hash.
+ *
+ * @param shard : Sharded dictionary to interact with
+ * @param key   : Precomputed key and group hash to match
+ * @param value : Value to associate with the slot
+ *
+ * @error CERR_OVERFLOW : The size of the resulting shard will be > SIZE_MAX, it would hold more than
+ *                        UINT32_MAX entries, or the shards store keys and the key is longer than 4GB
+ * @error CERR_MEMORY   : Failed memory allocation
+ */
+void
+cshard_write_hashed(cshard *shard, struct cdict_key key, size_t value)
+CSHARD_NONNULL(1);
+
+/**
+ * Same as cshard_write(), but with a key of explicit length that does not need to be NUL terminated.
+ *
+ * @param shard  : Sharded dictionary to interact with
+ * @param key    : Key to match
+ * @param length : Key length in bytes
+ * @param group  : Group to match
+ * @param value  : Value to associate with the slot
+ *
+ * @error CERR_OVERFLOW : The size of the resulting shard will be > SIZE_MAX, it would hold more than
+ *                        UINT32_MAX entries, or the shards store keys and the key is longer than 4GB
+ * @error CERR_MEMORY   : Failed memory allocation
+ */
+void
+cshard_write_n(cshard *shard, const char *key, size_t length, size_t group, size_t value)
+CSHARD_NONNULL(1, 2);
+
+/************************************************************************************************************/
+/* PURE METHODS *********************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Gets the error state of the sharded dictionary, or if it is valid, the error of the first shard that has
+ * one.
+ *
+ * @param shard : Sharded dictionary to interact with
+ *
+ * @return : Error value
+ */
+enum cerr
+cshard_error(const cshard *shard)
+CSHARD_NONNULL(1);
+
+/**
+ * Tries to find a slot that matches the given key and group. If found, true is returned, and if the optional
+ * value parameter is not NULL, the associated value of the found slot will be written into it. Only the shard
+ * the key maps to is locked.
+ *
+ * @param shard : Sharded dictionary to interact with
+ * @param key   : Key to match
+ * @param group : Group to match
+ * @param value : Optional parameter, value associated to the found slot
+ *
+ * @return     : Slot match
+ * @return_err : false
+ */
+bool
+cshard_find(const cshard *shard, const char *key, size_t group, size_t *value)
+CSHARD_NONNULL(1, 2);
+
+/**
+ * Same as cshard_find(), but with a precomputed key and group hash.
+ *
+ * @param shard : Sharded dictionary to interact with
+ * @param key   : Precomputed key and group hash to match
+ * @param value : Optional parameter, value associated to the found slot
+ *
+ * @return     : Slot match
+ * @return_err : false
+ */
+bool
+cshard_find_hashed(const cshard *shard, struct cdict_key key, size_t *value)
+CSHARD_NONNULL(1);
+
+/**
+ * Same as cshard_find(), but with a key of explicit length that does not need to be NUL terminated.
+ *
+ * @param shard  : Sharded dictionary to interact with
+ * @param key    : Key to match
+ * @param length : Key length in bytes
+ * @param group  : Group to match
+ * @param value  : Optional parameter, value associated to the found slot
+ *
+ * @return     : Slot match
+ * @return_err : false
+ */
+bool
+cshard_find_n(const cshard *shard, const char *key, size_t length, size_t group, size_t *value)
+CSHARD_NONNULL(1, 2);
+
+/**
+ * Gets the number of active slots of a specific group over all shards.
+ *
+ * @param shard : Sharded dictionary to interact with
+ * @param group : Group to match
+ *
+ * @return     : Number of slots
+ * @return_err : 0
+ */
+size_t
+cshard_group_length(const cshard *shard, size_t group)
+CSHARD_NONNULL(1);
+
+/**
+ * Computes the hash of a key and group with the hash function and seed shared by all shards. It does not lock
+ * anything. The result can be passed to the *_hashed() variants of cshard functions. The key does not need to
+ * be NUL terminated.
+ *
+ * @param shard  : Sharded dictionary to interact with
+ * @param key    : Key to hash
+ * @param length : Key length in bytes
+ * @param group  : Group to hash
+ *
+ * @return : Precomputed key and group hash
+ */
+struct cdict_key
+cshard_hash(const cshard *shard, const char *key, size_t length, size_t group)
+CSHARD_NONNULL(1, 2)
+CSHARD_PURE;
+
+/**
+ * Gets the number of active slots over all shards.
+ *
+ * @param shard : Sharded dictionary to interact with
+ *
+ * @return     : Number of slots
+ * @return_err : 0
+ */
+size_t
+cshard_load(const cshard *shard)
+CSHARD_NONNULL(1);
+
+/**
+ * Gets the number of shards.
+ *
+ * @param shard : Sharded dictionary to interact with
+ *
+ * @return     : Number of shards
+ * @return_err : 0
+ */
+size_t
+cshard_shards(const cshard *shard)
+CSHARD_NONNULL(1)
+CSHARD_PURE;
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
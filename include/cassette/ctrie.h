@@ -0,0 +1,354 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "cdict.h"
+#include "cerr.h"
+
+#if __GNUC__ > 4
+	#define CTRIE_NONNULL_RETURN __attribute__((returns_nonnull))
+	#define CTRIE_NONNULL(...)   __attribute__((nonnull (__VA_ARGS__)))
+	#define CTRIE_PURE           __attribute__((pure))
+#else
+	#define CTRIE_NONNULL_RETURN
+	#define CTRIE_NONNULL(...)
+	#define CTRIE_PURE
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/************************************************************************************************************/
+/* TYPES ****************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Opaque ordered string index object. Like a cdict, it maps a key and group pair to a value, but it keeps
+ * its entries sorted, by group first and then by the bytes of their keys, so that it can also list all keys
+ * that start with a given prefix, or that fall within a given range, in order. It is an adaptive radix
+ * tree : each inner node branches on one byte of the key and comes in 4 sizes (4, 16, 48 or 256 children)
+ * that get swapped as children are added or removed, and chains of nodes with a single child are folded
+ * into a prefix stored in their descendant. Nodes of 16 children are searched with SSE2 comparisons, and
+ * nodes of 48 children, which index their children by byte, scan that index 16 bytes at a time when looking
+ * for the next child in order. Lookups take time proportional to the key length instead of the number of
+ * entries, but touch a few nodes on the way, so a cdict stays faster for point lookups alone.
+ *
+ * Each entry keeps its own copy of its key, NUL terminated, in a leaf allocated along with it. Keys may
+ * contain any byte, including NUL, when passed with an explicit length.
+ *
+ * Lookups and iterations can be made from many threads at once, as long as the index is not modified at the
+ * same time. If an error occurs, or if the index could not be created, all methods will exit early with
+ * default return values and no side-effects. Some errors can be recovered with ctrie_repair().
+ */
+typedef struct ctrie ctrie;
+
+/************************************************************************************************************/
+/* GLOBALS **************************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * A macro that gives uninitialized indexes a non-NULL value that is safe to use with the index's related
+ * functions. However, any function called with a handle set to this value will return early and without any
+ * side effects.
+ */
+#define CTRIE_PLACEHOLDER (&ctrie_placeholder_instance)
+
+/**
+ * Global index instance with the error state set to CERR_INVALID. This instance is made available to allow
+ * the static initialization of index pointers with the macro CTRIE_PLACEHOLDER.
+ */
+extern ctrie ctrie_placeholder_instance;
+
+/************************************************************************************************************/
+/* CONSTRUCTORS / DESTRUCTORS *******************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Creates an index and copies the entries of another index into it.
+ *
+ * @param trie : Index to copy contents from
+ *
+ * @return     : New index instance
+ * @return_err : CTRIE_PLACEHOLDER
+ */
+ctrie *
+ctrie_clone(const ctrie *trie)
+CTRIE_NONNULL_RETURN
+CTRIE_NONNULL(1);
+
+/**
+ * Creates an empty index.
+ *
+ * @return     : New index instance
+ * @return_err : CTRIE_PLACEHOLDER
+ */
+ctrie *
+ctrie_create(void)
+CTRIE_NONNULL_RETURN;
+
+/**
+ * Destroys the given index and frees memory.
+ *
+ * @param trie : Index to interact with
+ */
+void
+ctrie_destroy(ctrie *trie)
+CTRIE_NONNULL(1);
+
+/************************************************************************************************************/
+/* IMPURE METHODS *******************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Convenience for-loop wrapper over all entries, in order. ENTRY must be a struct cdict_entry variable, and
+ * the entry it holds must not be erased inside the loop.
+ */
+#define CTRIE_FOR_EACH(TRIE, ENTRY) \
+	for (ENTRY = (struct cdict_entry){0}; ctrie_next(TRIE, &ENTRY);)
+
+/**
+ * Convenience for-loop wrapper over the entries of a group whose keys start with the given prefix, in order.
+ * ENTRY must be a struct cdict_entry variable, and the entry it holds must not be erased inside the loop.
+ */
+#define CTRIE_FOR_EACH_IN_PREFIX(TRIE, PREFIX, GROUP, ENTRY) \
+	for (ENTRY = (struct cdict_entry){0}; ctrie_next_in_prefix(TRIE, PREFIX, GROUP, &ENTRY);)
+
+/**
+ * Removes all entries. Their memory is freed.
+ *
+ * @param trie : Index to interact with
+ */
+void
+ctrie_clear(ctrie *trie)
+CTRIE_NONNULL(1);
+
+/**
+ * Removes the entry that matches the given key and group. This function has no effect if there are no
+ * matching entries. Nodes left with too few children are swapped for smaller ones, and nodes left with a
+ * single child are merged into it.
+ *
+ * @param trie  : Index to interact with
+ * @param key   : Key to match
+ * @param group : Group to match
+ */
+void
+ctrie_erase(ctrie *trie, const char *key, size_t group)
+CTRIE_NONNULL(1, 2);
+
+/**
+ * Same as ctrie_erase(), but with a key of explicit length that does not need to be NUL terminated.
+ *
+ * @param trie   : Index to interact with
+ * @param key    : Key to match
+ * @param length : Key length in bytes
+ * @param group  : Group to match
+ */
+void
+ctrie_erase_n(ctrie *trie, const char *key, size_t length, size_t group)
+CTRIE_NONNULL(1, 2);
+
+/**
+ * Clears errors and puts the index back into an usable state. The only unrecoverable error is
+ * CERR_INVALID.
+ *
+ * @param trie : Index to interact with
+ */
+void
+ctrie_repair(ctrie *trie)
+CTRIE_NONNULL(1);
+
+/**
+ * Associates a value to the given key and group. If an entry with a matching key and group already exists,
+ * this function will only overwrite its value.
+ *
+ * @param trie  : Index to interact with
+ * @param key   : Key to match
+ * @param group : Group to match
+ * @param value : Value to associate with the entry
+ *
+ * @error CERR_OVERFLOW : The key is longer than 4GB
+ * @error CERR_MEMORY   : Failed memory allocation
+ */
+void
+ctrie_write(ctrie *trie, const char *key, size_t group, size_t value)
+CTRIE_NONNULL(1, 2);
+
+/**
+ * Same as ctrie_write(), but with a key of explicit length that does not need to be NUL terminated.
+ *
+ * @param trie   : Index to interact with
+ * @param key    : Key to match
+ * @param length : Key length in bytes
+ * @param group  : Group to match
+ * @param value  : Value to associate with the entry
+ *
+ * @error CERR_OVERFLOW : The key is longer than 4GB
+ * @error CERR_MEMORY   : Failed memory allocation
+ */
+void
+ctrie_write_n(ctrie *trie, const char *key, size_t length, size_t group, size_t value)
+CTRIE_NONNULL(1, 2);
+
+/************************************************************************************************************/
+/* PURE METHODS *********************************************************************************************/
+/************************************************************************************************************/
+
+/**
+ * Gets the error state.
+ *
+ * @param trie : Index to interact with
+ *
+ * @return : Error value
+ */
+enum cerr
+ctrie_error(const ctrie *trie)
+CTRIE_NONNULL(1)
+CTRIE_PURE;
+
+/**
+ * Tries to find an entry that matches the given key and group. If found, true is returned, and if the
+ * optional value parameter is not NULL, the value of the found entry will be written into it.
+ *
+ * @param trie  : Index to interact with
+ * @param key   : Key to match
+ * @param group : Group to match
+ * @param value : Optional parameter, value of the found entry
+ *
+ * @return     : Entry match
+ * @return_err : false
+ */
+bool
+ctrie_find(const ctrie *trie, const char *key, size_t group, size_t *value)
+CTRIE_NONNULL(1, 2);
+
+/**
+ * Same as ctrie_find(), but with a key of explicit length that does not need to be NUL terminated.
+ *
+ * @param trie   : Index to interact with
+ * @param key    : Key to match
+ * @param length : Key length in bytes
+ * @param group  : Group to match
+ * @param value  : Optional parameter, value of the found entry
+ *
+ * @return     : Entry match
+ * @return_err : false
+ */
+bool
+ctrie_find_n(const ctrie *trie, const char *key, size_t length, size_t group, size_t *value)
+CTRIE_NONNULL(1, 2);
+
+/**
+ * Gets the number of entries.
+ *
+ * @param trie : Index to interact with
+ *
+ * @return     : Number of entries
+ * @return_err : 0
+ */
+size_t
+ctrie_load(const ctrie *trie)
+CTRIE_NONNULL(1)
+CTRIE_PURE;
+
+/**
+ * Iterates over all entries in order, by group and then by key, bytes being compared as unsigned values and
+ * shorter keys coming before the longer keys they prefix. The entry's key must be set to NULL before the
+ * first call, for instance by zeroing it, and the entry must then be passed back unchanged, as it is the
+ * iteration state. Each call writes the next entry into it and returns true, until there are none left. The
+ * written key points into the index, is NUL terminated and stays valid until that entry gets erased.
+ * Modifying the index between calls does not break the iteration, which resumes after the last returned
+ * key, as long as that key was not erased.
+ *
+ * @param trie  : Index to interact with
+ * @param entry : Iteration state and next entry
+ *
+ * @return     : Entry match
+ * @return_err : false
+ */
+bool
+ctrie_next(const ctrie *trie, struct cdict_entry *entry)
+CTRIE_NONNULL(1, 2);
+
+/**
+ * Same as ctrie_next(), but only over the entries of the given group whose keys start with the given
+ * prefix. An empty prefix iterates over the whole group.
+ *
+ * @param trie   : Index to interact with
+ * @param prefix : Key prefix to match
+ * @param group  : Group to match
+ * @param entry  : Iteration state and next entry
+ *
+ * @return     : Entry match
+ * @return_err : false
+ */
+bool
+ctrie_next_in_prefix(const ctrie *trie, const char *prefix, size_t group, struct cdict_entry *entry)
+CTRIE_NONNULL(1, 2, 4);
+
+/**
+ * Same as ctrie_next_in_prefix(), but with a prefix of explicit length that does not need to be NUL
+ * terminated.
+ *
+ * @param trie   : Index to interact with
+ * @param prefix : Key prefix to match
+ * @param length : Prefix length in bytes
+ * @param group  : Group to match
+ * @param entry  : Iteration state and next entry
+ *
+ * @return     : Entry match
+ * @return_err : false
+ */
+bool
+ctrie_next_in_prefix_n(const ctrie *trie, const char *prefix, size_t length, size_t group,
+                       struct cdict_entry *entry)
+CTRIE_NONNULL(1, 2, 5);
+
+/**
+ * Same as ctrie_next(), but only over the entries of the given group whose keys fall within the range
+ * [from, to[. Either bound may be NULL to leave that side of the range open. Keys of explicit length can be
+ * compared to bounds, but the bounds themselves must be NUL terminated.
+ *
+ * @param trie  : Index to interact with
+ * @param from  : Optional parameter, smallest key to match
+ * @param to    : Optional parameter, first key past the range
+ * @param group : Group to match
+ * @param entry : Iteration state and next entry
+ *
+ * @return     : Entry match
+ * @return_err : false
+ */
+bool
+ctrie_next_in_range(const ctrie *trie, const char *from, const char *to, size_t group,
+                    struct cdict_entry *entry)
+CTRIE_NONNULL(1, 5);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,304 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#include <cassette/cobj.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "safe.h"
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define BLOCK_BITS  256
+#define BLOCK_WORDS 8
+#define BLOCKS_MAX  ((size_t)UINT32_MAX + 1)
+#define CACHE_LINE  64
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/* blocks are made of 8 words of 32 bits, 2 of them fill a cache line */
+
+struct cbloom
+{
+	uint32_t *blocks;
+	size_t n;
+	enum cerr err;
+};
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static cbloom   *allocate (size_t);
+static uint32_t *block    (const cbloom *, uint64_t)                CBLOOM_NONNULL(1) CBLOOM_PURE;
+static void      mask     (uint64_t, uint32_t [static BLOCK_WORDS]) CBLOOM_NONNULL(2);
+static bool      match    (const uint32_t *, uint64_t)              CBLOOM_NONNULL(1) CBLOOM_PURE;
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/* odd multipliers that spread a hash over the 32 bits of each word of a block */
+
+static const uint32_t salts[BLOCK_WORDS] =
+{
+	0x47B6137B, 0x44974D91, 0x8824AD5B, 0xA2B7289D, 0x705495C7, 0x2DF1424B, 0x9EFC4947, 0x5C6BFB31,
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cbloom cbloom_placeholder_instance =
+{
+	.blocks = NULL,
+	.n      = 0,
+	.err    = CERR_INVALID,
+};
+
+/************************************************************************************************************/
+/* PUBLIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+void
+cbloom_add(cbloom *bloom, uint64_t hash)
+{
+	uint32_t m[BLOCK_WORDS];
+	uint32_t *b;
+
+	if (bloom->err)
+	{
+		return;
+	}
+
+	b = block(bloom, hash);
+
+	mask(hash, m);
+
+	for (size_t i = 0; i < BLOCK_WORDS; i++)
+	{
+		b[i] |= m[i];
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+cbloom_bytes(const cbloom *bloom)
+{
+	if (bloom->err)
+	{
+		return 0;
+	}
+
+	return bloom->n * BLOCK_BITS / 8;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cbloom_clear(cbloom *bloom)
+{
+	if (bloom->err)
+	{
+		return;
+	}
+
+	memset(bloom->blocks, 0, bloom->n * BLOCK_BITS / 8);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cbloom *
+cbloom_clone(const cbloom *bloom)
+{
+	cbloom *bloom_new;
+
+	if (bloom->err || !(bloom_new = allocate(bloom->n)))
+	{
+		return CBLOOM_PLACEHOLDER;
+	}
+
+	memcpy(bloom_new->blocks, bloom->blocks, bloom->n * BLOCK_BITS / 8);
+
+	return bloom_new;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cbloom *
+cbloom_create(size_t hashes_number, size_t bits_per_hash)
+{
+	cbloom *bloom;
+	size_t n;
+
+	if (bits_per_hash == 0 || bits_per_hash > 64 || !safe_mul(&n, hashes_number, bits_per_hash))
+	{
+		return CBLOOM_PLACEHOLDER;
+	}
+
+	if (!(bloom = allocate(n / BLOCK_BITS + 1)))
+	{
+		return CBLOOM_PLACEHOLDER;
+	}
+
+	memset(bloom->blocks, 0, bloom->n * BLOCK_BITS / 8);
+
+	return bloom;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cbloom_destroy(cbloom *bloom)
+{
+	if (bloom == CBLOOM_PLACEHOLDER)
+	{
+		return;
+	}
+
+	free(bloom->blocks);
+	free(bloom);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+enum cerr
+cbloom_error(const cbloom *bloom)
+{
+	return bloom->err;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cbloom_test(const cbloom *bloom, uint64_t hash)
+{
+	if (bloom->err)
+	{
+		return true;
+	}
+
+	return match(block(bloom, hash), hash);
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static cbloom *
+allocate(size_t n)
+{
+	cbloom *bloom;
+
+	/* an even number of blocks keeps the allocation size a multiple of its cache line alignment */
+
+	n += n % 2;
+
+	if (n > BLOCKS_MAX || !(bloom = malloc(sizeof(cbloom))))
+	{
+		return NULL;
+	}
+
+	if (!(bloom->blocks = aligned_alloc(CACHE_LINE, n * BLOCK_BITS / 8)))
+	{
+		free(bloom);
+		return NULL;
+	}
+
+	bloom->n   = n;
+	bloom->err = CERR_NONE;
+
+	return bloom;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static uint32_t *
+block(const cbloom *bloom, uint64_t hash)
+{
+	/* hashes come in already mixed. the low half picks the block, since cshard gives all keys of a shard */
+	/* some of the same high bits, and the high half, spread by the salts, picks the bits set within it    */
+
+	return bloom->blocks + ((hash & UINT32_MAX) * bloom->n >> 32) * BLOCK_WORDS;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+mask(uint64_t hash, uint32_t m[static BLOCK_WORDS])
+{
+	for (size_t i = 0; i < BLOCK_WORDS; i++)
+	{
+		m[i] = (uint32_t)1 << ((uint32_t)(hash >> 32) * salts[i] >> 27);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+match(const uint32_t *b, uint64_t hash)
+{
+	/* all 8 bits of the hash must be set in the block, one per word */
+
+#if defined(__AVX2__)
+	__m256i salt = _mm256_loadu_si256((const __m256i*)salts);
+	__m256i bits = _mm256_mullo_epi32(_mm256_set1_epi32((int)(uint32_t)(hash >> 32)), salt);
+	__m256i m    = _mm256_sllv_epi32(_mm256_set1_epi32(1), _mm256_srli_epi32(bits, 27));
+
+	return _mm256_testc_si256(_mm256_load_si256((const __m256i*)b), m);
+#elif defined(__SSE2__)
+	_Alignas(16) uint32_t m[BLOCK_WORDS];
+	__m128i lo;
+	__m128i hi;
+
+	mask(hash, m);
+
+	lo = _mm_load_si128((const __m128i*)m);
+	hi = _mm_load_si128((const __m128i*)m + 1);
+	lo = _mm_cmpeq_epi32(_mm_and_si128(_mm_load_si128((const __m128i*)b), lo), lo);
+	hi = _mm_cmpeq_epi32(_mm_and_si128(_mm_load_si128((const __m128i*)b + 1), hi), hi);
+
+	return _mm_movemask_epi8(_mm_and_si128(lo, hi)) == 0xFFFF;
+#else
+	uint32_t m[BLOCK_WORDS];
+	uint32_t missing = 0;
+
+	mask(hash, m);
+
+	for (size_t i = 0; i < BLOCK_WORDS; i++)
+	{
+		missing |= m[i] & ~b[i];
+	}
+
+	return !missing;
+#endif
+}
@@ -24,23 +24,43 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "hash.h"
 #include "safe.h"
 
 /************************************************************************************************************/
 /************************************************************************************************************/
 /************************************************************************************************************/
 
+#define INTERN_SLOTS 16
+#define NONE         SIZE_MAX
+
+#define WIDTH(B)     ((B)->flags & CBOOK_COMPACT_OFFSETS ? sizeof(uint32_t) : sizeof(size_t))
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/* interned books keep a hashtable of the words that first wrote each unique string, and the list of these */
+/* words in writing order. because the book is a stack, they get removed from the table in the reverse of  */
+/* that order, which lets slots be emptied without tombstones. words and groups take WIDTH() bytes each   */
+
 struct cbook
 {
 	char *chars;
-	size_t *words;
-	size_t *groups;
+	void *words;
+	void *groups;
+	size_t *slots;
+	size_t *firsts;
 	size_t n_chars;
 	size_t n_words;
 	size_t n_groups;
+	size_t n_firsts;
+	size_t n_slots;
 	size_t n_alloc_chars;
 	size_t n_alloc_words;
 	size_t n_alloc_groups;
+	uint64_t seed;
+	unsigned int flags;
 	bool new_group;
 	enum cerr err;
 };
@@ -49,8 +69,15 @@ struct cbook
 /************************************************************************************************************/
 /************************************************************************************************************/
 
-static size_t group_size (const cbook *, size_t) CBOOK_PURE CBOOK_NONNULL(1);
-static bool   grow       (cbook *, size_t, size_t, size_t)  CBOOK_NONNULL(1);
+static size_t field_get    (const cbook *, const void *, size_t)           CBOOK_PURE CBOOK_NONNULL(1, 2);
+static void   field_set    (const cbook *, void *, size_t, size_t)         CBOOK_NONNULL(1, 2);
+static size_t group_size   (const cbook *, size_t)                         CBOOK_PURE CBOOK_NONNULL(1);
+static bool   grow         (cbook *, size_t, size_t, size_t)               CBOOK_NONNULL(1);
+static void   intern_clear (cbook *)                                       CBOOK_NONNULL(1);
+static size_t intern_find  (const cbook *, const char *, size_t, size_t *) CBOOK_NONNULL(1, 2, 4);
+static bool   intern_grow  (cbook *, size_t)                               CBOOK_NONNULL(1);
+static void   unwind       (cbook *, size_t)                               CBOOK_NONNULL(1);
+static bool   widen        (cbook *)                                       CBOOK_NONNULL(1);
 
 /************************************************************************************************************/
 /************************************************************************************************************/
@@ -61,12 +88,18 @@ cbook cbook_placeholder_instance =
 	.chars          = NULL,
 	.words          = NULL,
 	.groups         = NULL,
+	.slots          = NULL,
+	.firsts         = NULL,
 	.n_chars        = 0,
 	.n_words        = 0,
 	.n_groups       = 0,
+	.n_firsts       = 0,
+	.n_slots        = 0,
 	.n_alloc_chars  = 0,
 	.n_alloc_words  = 0,
 	.n_alloc_groups = 0,
+	.seed           = 0,
+	.flags          = 0,
 	.new_group      = false,
 	.err            = CERR_INVALID,
 };
@@ -87,6 +120,8 @@ cbook_clear(cbook *book)
 	book->n_words   = 0;
 	book->n_chars   = 0;
 	book->new_group = true;
+
+	intern_clear(book);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -101,22 +136,30 @@ cbook_clone(const cbook *book)
 		return CBOOK_PLACEHOLDER;
 	}
 
-	if (!grow(book_new, book->n_alloc_chars, book->n_alloc_words, book->n_alloc_groups))
+	book_new->flags = book->flags;
+
+	if (!grow(book_new, book->n_alloc_chars, book->n_alloc_words, book->n_alloc_groups)
+	 || (book->slots && !intern_grow(book_new, book->n_slots)))
 	{
-		free(book_new->chars);
-		free(book_new->words);
-		free(book_new->groups);
-		free(book_new);
+		cbook_destroy(book_new);
 		return CBOOK_PLACEHOLDER;
 	}
 
 	memcpy(book_new->chars,  book->chars,  book->n_chars);
-	memcpy(book_new->words,  book->words,  book->n_words  * sizeof(size_t));
-	memcpy(book_new->groups, book->groups, book->n_groups * sizeof(size_t));
+	memcpy(book_new->words,  book->words,  book->n_words  * WIDTH(book));
+	memcpy(book_new->groups, book->groups, book->n_groups * WIDTH(book));
+
+	if (book->slots)
+	{
+		memcpy(book_new->slots,  book->slots,  book->n_slots  * sizeof(size_t));
+		memcpy(book_new->firsts, book->firsts, book->n_firsts * sizeof(size_t));
+	}
 
 	book_new->n_chars   = book->n_chars;
 	book_new->n_words   = book->n_words;
 	book_new->n_groups  = book->n_groups;
+	book_new->n_firsts  = book->n_firsts;
+	book_new->seed      = book->seed;
 	book_new->new_group = book->new_group;
 	book_new->err       = CERR_NONE;
 
@@ -127,26 +170,35 @@ cbook_clone(const cbook *book)
 
 cbook *
 cbook_create(void)
+{
+	return cbook_create_with_flags(0);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cbook *
+cbook_create_with_flags(unsigned int flags)
 {
 	cbook *book;
 
-	if (!(book = calloc(1, sizeof(cbook))))
+	if (flags & ~(unsigned int)(CBOOK_INTERN | CBOOK_COMPACT_OFFSETS) || !(book = calloc(1, sizeof(cbook))))
 	{
 		return CBOOK_PLACEHOLDER;
 	}
 
-	if (!grow(book, 1, 1, 1))
+	book->flags = flags;
+
+	if (!grow(book, 1, 1, 1) || (flags & CBOOK_INTERN && !intern_grow(book, INTERN_SLOTS)))
 	{
-		free(book->chars);
-		free(book->words);
-		free(book->groups);
-		free(book);
+		cbook_destroy(book);
 		return CBOOK_PLACEHOLDER;
 	}
 
 	book->n_chars   = 0;
 	book->n_words   = 0;
 	book->n_groups  = 0;
+	book->n_firsts  = 0;
+	book->seed      = flags & CBOOK_INTERN ? hash_seed() : 0;
 	book->new_group = true;
 	book->err       = CERR_NONE;
 
@@ -163,6 +215,8 @@ cbook_destroy(cbook *book)
 		return;
 	}
 
+	free(book->firsts);
+	free(book->slots);
 	free(book->groups);
 	free(book->words);
 	free(book->chars);
@@ -179,6 +233,22 @@ cbook_error(const cbook *book)
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
+size_t
+cbook_find_id(const cbook *book, const char *str)
+{
+	size_t slot;
+	size_t w;
+
+	if (book->err || !book->slots || (w = intern_find(book, str, strlen(str), &slot)) == NONE)
+	{
+		return NONE;
+	}
+
+	return field_get(book, book->words, w);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
 size_t
 cbook_group_length(const cbook *book, size_t group_index)
 {
@@ -226,8 +296,7 @@ cbook_pop_group(cbook *book)
 		return;
 	}
 
-	book->n_chars = book->words[book->groups[--book->n_groups]];
-	book->n_words = book->groups[book->n_groups];
+	unwind(book, field_get(book, book->groups, --book->n_groups));
 
 	if (book->n_groups == 0)
 	{
@@ -245,7 +314,7 @@ cbook_pop_word(cbook *book)
 		return;
 	}
 
-	if (book->groups[book->n_groups - 1] == book->n_words - 1)
+	if (field_get(book, book->groups, book->n_groups - 1) == book->n_words - 1)
 	{
 		if (--book->n_groups == 0)
 		{
@@ -253,7 +322,7 @@ cbook_pop_word(cbook *book)
 		}
 	}
 
-	book->n_chars = book->words[--book->n_words];
+	unwind(book, book->n_words - 1);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -316,7 +385,20 @@ cbook_word(const cbook *book, size_t word_index)
 		return "";
 	}
 
-	return book->chars + book->words[word_index];
+	return book->chars + field_get(book, book->words, word_index);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+cbook_word_id(const cbook *book, size_t word_index)
+{
+	if (book->err || word_index >= book->n_words)
+	{
+		return NONE;
+	}
+
+	return field_get(book, book->words, word_index);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -331,7 +413,9 @@ cbook_word_in_group(const cbook *book, size_t group_index, size_t word_local_ind
 		return "";
 	}
 
-	return book->chars + book->words[book->groups[group_index] + word_local_index];
+	word_local_index += field_get(book, book->groups, group_index);
+
+	return book->chars + field_get(book, book->words, word_local_index);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -346,7 +430,7 @@ cbook_word_index(const cbook *book, size_t group_index, size_t word_local_index)
 		return 0;
 	}
 
-	return book->groups[group_index] + word_local_index;
+	return field_get(book, book->groups, group_index) + word_local_index;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -371,6 +455,8 @@ cbook_write(cbook *book, const char *str)
 	size_t nc;
 	size_t nw;
 	size_t ng;
+	size_t slot  = 0;
+	size_t first = NONE;
 
 	if (book->err)
 	{
@@ -378,6 +464,30 @@ cbook_write(cbook *book, const char *str)
 	}
 
 	ns = strlen(str) + 1;
+
+	/* the interning table is grown ahead of the lookup, so that the found slot stays valid */
+
+	if (book->slots)
+	{
+		if (book->n_firsts >= book->n_slots / 2 && !intern_grow(book, book->n_slots * 2))
+		{
+			return;
+		}
+		if ((first = intern_find(book, str, ns - 1, &slot)) != NONE)
+		{
+			ns = 0;
+		}
+	}
+
+	/* compact offsets are widened for good once the book holds more than they can address */
+
+	if (book->flags & CBOOK_COMPACT_OFFSETS
+	 && (book->n_chars > UINT32_MAX || book->n_words > UINT32_MAX)
+	 && !widen(book))
+	{
+		return;
+	}
+
 	nc = book->n_alloc_chars;
 	nw = book->n_alloc_words  * (book->n_words  >= book->n_alloc_words  ? 2 : 1);
 	ng = book->n_alloc_groups * (book->n_groups >= book->n_alloc_groups ? 2 : 1);
@@ -398,12 +508,24 @@ cbook_write(cbook *book, const char *str)
 
 	if (book->new_group)
 	{
-		book->groups[book->n_groups++] = book->n_words;
+		field_set(book, book->groups, book->n_groups++, book->n_words);
 		book->new_group = false;
 	}
 
+	if (first != NONE)
+	{
+		field_set(book, book->words, book->n_words++, field_get(book, book->words, first));
+		return;
+	}
+
+	if (book->slots)
+	{
+		book->slots[slot]              = book->n_words;
+		book->firsts[book->n_firsts++] = book->n_words;
+	}
+
 	memmove(book->chars + book->n_chars, str, ns);
-	book->words[book->n_words++] = book->n_chars;
+	field_set(book, book->words, book->n_words++, book->n_chars);
 	book->n_chars += ns;
 }
 
@@ -422,12 +544,42 @@ cbook_zero(cbook *book)
 	book->n_groups = 0;
 	book->n_words  = 0;
 	book->n_chars  = 0;
+
+	intern_clear(book);
 }
 
 /************************************************************************************************************/
 /* STATIC ***************************************************************************************************/
 /************************************************************************************************************/
 
+static size_t
+field_get(const cbook *book, const void *array, size_t i)
+{
+	if (book->flags & CBOOK_COMPACT_OFFSETS)
+	{
+		return ((const uint32_t*)array)[i];
+	}
+
+	return ((const size_t*)array)[i];
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+field_set(const cbook *book, void *array, size_t i, size_t value)
+{
+	if (book->flags & CBOOK_COMPACT_OFFSETS)
+	{
+		((uint32_t*)array)[i] = value;
+	}
+	else
+	{
+		((size_t*)array)[i] = value;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
 static size_t
 group_size(const cbook *book, size_t i)
 {
@@ -437,11 +589,11 @@ group_size(const cbook *book, size_t i)
 	}
 	else if (i == book->n_groups - 1)
 	{
-		return book->n_words - book->groups[i];
+		return book->n_words - field_get(book, book->groups, i);
 	}
 	else
 	{
-		return book->groups[i + 1] - book->groups[i];
+		return field_get(book, book->groups, i + 1) - field_get(book, book->groups, i);
 	}
 }
 
@@ -452,8 +604,8 @@ grow(cbook *book, size_t n_chars, size_t n_words, size_t n_groups)
 {
 	void *tmp;
 
-	if (!safe_mul(NULL, n_words,  sizeof(size_t))
-	 || !safe_mul(NULL, n_groups, sizeof(size_t)))
+	if (!safe_mul(NULL, n_words,  WIDTH(book))
+	 || !safe_mul(NULL, n_groups, WIDTH(book)))
 	{
 		book->err = CERR_OVERFLOW;
 		return false;
@@ -476,7 +628,7 @@ grow(cbook *book, size_t n_chars, size_t n_words, size_t n_groups)
 
 	if (n_words > book->n_alloc_words)
 	{
-		if (!(tmp = realloc(book->words, n_words * sizeof(size_t))))
+		if (!(tmp = realloc(book->words, n_words * WIDTH(book))))
 		{
 			book->err = CERR_MEMORY;
 			return false;
@@ -489,7 +641,7 @@ grow(cbook *book, size_t n_chars, size_t n_words, size_t n_groups)
 
 	if (n_groups > book->n_alloc_groups)
 	{
-		if (!(tmp = realloc(book->groups, n_groups * sizeof(size_t))))
+		if (!(tmp = realloc(book->groups, n_groups * WIDTH(book))))
 		{
 			book->err = CERR_MEMORY;
 			return false;
@@ -502,3 +654,155 @@ grow(cbook *book, size_t n_chars, size_t n_words, size_t n_groups)
 
 	return true;
 }
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+intern_clear(cbook *book)
+{
+	if (book->slots)
+	{
+		memset(book->slots, 0xFF, book->n_slots * sizeof(size_t));
+	}
+
+	book->n_firsts = 0;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+intern_find(const cbook *book, const char *str, size_t length, size_t *slot)
+{
+	size_t i;
+
+	i = hash_wy(str, length, 0, book->seed) & (book->n_slots - 1);
+
+	for (; book->slots[i] != NONE; i = (i + 1) & (book->n_slots - 1))
+	{
+		if (strcmp(book->chars + field_get(book, book->words, book->slots[i]), str) == 0)
+		{
+			break;
+		}
+	}
+
+	*slot = i;
+
+	return book->slots[i];
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+intern_grow(cbook *book, size_t n)
+{
+	const char *str;
+	size_t *slots;
+	void *tmp;
+	size_t slot;
+
+	/* the table is kept at most half full, so firsts never outgrows half of its slots */
+
+	if (!safe_mul(NULL, n, sizeof(size_t)))
+	{
+		book->err = CERR_OVERFLOW;
+		return false;
+	}
+
+	if (!(slots = malloc(n * sizeof(size_t))) || !(tmp = realloc(book->firsts, n / 2 * sizeof(size_t))))
+	{
+		free(slots);
+		book->err = CERR_MEMORY;
+		return false;
+	}
+
+	free(book->slots);
+	memset(slots, 0xFF, n * sizeof(size_t));
+
+	book->slots   = slots;
+	book->firsts  = tmp;
+	book->n_slots = n;
+
+	/* words are put back in writing order, as if the table always had this size */
+
+	for (size_t i = 0; i < book->n_firsts; i++)
+	{
+		str = book->chars + field_get(book, book->words, book->firsts[i]);
+		intern_find(book, str, strlen(str), &slot);
+		book->slots[slot] = book->firsts[i];
+	}
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+unwind(cbook *book, size_t n)
+{
+	const char *str;
+	size_t slot;
+
+	/* in interned books, words only own their characters if they were the first to write their string */
+
+	if (!book->slots)
+	{
+		book->n_chars = field_get(book, book->words, n);
+	}
+
+	for (; book->n_firsts > 0 && book->firsts[book->n_firsts - 1] >= n; book->n_firsts--)
+	{
+		book->n_chars = field_get(book, book->words, book->firsts[book->n_firsts - 1]);
+		str           = book->chars + book->n_chars;
+		intern_find(book, str, strlen(str), &slot);
+		book->slots[slot] = NONE;
+	}
+
+	book->n_words = n;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+widen(cbook *book)
+{
+	void *tmp;
+
+	if (!safe_mul(NULL, book->n_alloc_words,  sizeof(size_t))
+	 || !safe_mul(NULL, book->n_alloc_groups, sizeof(size_t)))
+	{
+		book->err = CERR_OVERFLOW;
+		return false;
+	}
+
+	/* a failure leaves both arrays bigger than needed but still compact, which is harmless */
+
+	if (!(tmp = realloc(book->words, book->n_alloc_words * sizeof(size_t))))
+	{
+		book->err = CERR_MEMORY;
+		return false;
+	}
+	book->words = tmp;
+
+	if (!(tmp = realloc(book->groups, book->n_alloc_groups * sizeof(size_t))))
+	{
+		book->err = CERR_MEMORY;
+		return false;
+	}
+	book->groups = tmp;
+
+	/* offsets are widened in place from the end, so that none gets overwritten before being read */
+
+	for (size_t i = book->n_words; i-- > 0;)
+	{
+		((size_t*)book->words)[i] = ((uint32_t*)book->words)[i];
+	}
+
+	for (size_t i = book->n_groups; i-- > 0;)
+	{
+		((size_t*)book->groups)[i] = ((uint32_t*)book->groups)[i];
+	}
+
+	book->flags &= ~(unsigned int)CBOOK_COMPACT_OFFSETS;
+
+	return true;
+}
@@ -18,452 +18,5409 @@
 /************************************************************************************************************/
 /************************************************************************************************************/
 
+/* anonymous mappings and madvise() are extensions to POSIX */
+
+#define _DEFAULT_SOURCE
+
 #include <cassette/cobj.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
+#include "hash.h"
+#include "safe.h"
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define BATCH_WIDTH    16
+#define BUILD_SLICE    4096
+#define BUILD_THREADS  256
+#define CACHE_LINE     64
+#define CHAIN_MIX      0x9E3779B97F4A7C15
+#define CUCKOO_LOAD    0.9
+#define CUCKOO_MIX     0xC2B2AE3D27D4EB4F
+#define CUCKOO_PATH    256
+#define CUCKOO_STASH   8
+#define CUCKOO_WAYS    4
+#define FROZEN_MAGIC   "cdictfz"
+#define FROZEN_ORDER   0x01020304
+#define FROZEN_VERSION 4
+#define GROUP_WIDTH    16
+#define HUGE_PAGE      (1 << 21)
+#define INDEX_MAX      UINT32_MAX
+#define INDEX_NONE     UINT32_MAX
+#define NONE           SIZE_MAX
+#define PILOT_DIRECT   ((uint32_t)1 << 31)
+#define PILOT_LOAD     2
+#define PILOT_TRIES    (1 << 16)
+#define READER_SLOTS   64
+#define SECTIONS       14
+#define SHARE_MIN      (1 << 18)
+#define SHRINK_FLOOR   0.25
+#define SHRINK_TARGET  0.5
+#define SPANS_MAX      64
+#define STORE_TRIES    16
+#define SWEEP_FLOOR    0.25
+
+#define ALIGN(N)       (((N) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE)
+#define HUGE_ALIGN(N)  (((N) + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE)
+#define WIDTH(D)       ((D)->flags & CDICT_COMPACT_VALUES ? sizeof(uint32_t) : sizeof(size_t))
+#define VALUE_WIDTH(D) ((D)->value_size ? (D)->value_size : WIDTH(D))
+
+#if __GNUC__ > 4
+	#define PREFETCH(ADDR) __builtin_prefetch(ADDR)
+#else
+	#define PREFETCH(ADDR)
+#endif
+
+/* control bytes, full slots keep the 7 top bits of their entry's hash as a tag */
+/* in robin hood mode they instead hold the slot's probe distance + 1           */
+/* cuckoo tables are made of buckets of 4 slots, followed by a stash of 8 slots */
+
+#define CTRL_EMPTY   0x00
+#define CTRL_DELETED 0x01
+#define CTRL_FULL    0x80
+#define CTRL_FAR     0xFF
+
+#define TAG(HASH) ((uint8_t)(CTRL_FULL | ((HASH) >> 57)))
+#define DIST(D)   ((uint8_t)((D) < CTRL_FAR - 1 ? (D) + 1 : CTRL_FAR))
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct key
+{
+	size_t offset;
+	uint32_t length;
+	uint32_t prefix;
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct link
+{
+	size_t prev;
+	size_t next;
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct chain
+{
+	size_t group;
+	size_t first;
+	size_t last;
+	size_t n;
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* frozen images start with this header, followed by their arrays at cache line aligned offsets. the byte */
+/* order mark and size_t width tell apart images written on incompatible machines                         */
+
+struct frozen
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t order;
+	uint32_t size_width;
+	uint32_t flags;
+	uint32_t hash;
+	uint32_t probing;
+	uint64_t seed;
+	uint64_t n_alloc;
+	uint64_t n_pilots;
+	uint64_t n;
+	uint64_t n_deleted;
+	uint64_t n_entries;
+	uint64_t n_chars;
+	uint64_t value_size;
+	uint64_t size;
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct layout
+{
+	size_t ctrl;
+	size_t pilots;
+	size_t index;
+	size_t hashes;
+	size_t values;
+	size_t groups;
+	size_t live;
+	size_t keys;
+	size_t chars;
+	size_t size;
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* readers are spread over counters on their own cache lines so that they never write to a shared line */
+
+struct reader
+{
+	_Alignas(CACHE_LINE) atomic_size_t n;
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* concurrent dictionaries keep a twin that takes every modification as well. lookups go to whichever of  */
+/* the two is in front, while the writer modifies the other one, puts it in front, then waits for readers */
+/* of the previous front to leave before modifying that one too. readers count themselves on the epoch    */
+/* they started in, and the writer only waits for one epoch at a time, so new readers never hold it back  */
+
+struct readers
+{
+	_Alignas(CACHE_LINE) _Atomic(cdict*) front;
+	atomic_size_t epoch;
+	cdict *twin;
+	bool replay;
+	bool split;
+	struct reader slots[2][READER_SLOTS];
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* lookup outcomes are only counted once every period lookups, so that readers seldom write to the shared   */
+/* counters. lookups are ticked on the counter of the thread's reader slot, which belongs to the dictionary */
+/* so that each one samples its own lookups                                                                 */
+
+struct sampler
+{
+	_Alignas(CACHE_LINE) atomic_size_t hits;
+	atomic_size_t misses;
+	size_t period;
+	struct reader ticks[READER_SLOTS];
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* hashtable slots only hold the index of their entry. perfect tables have no control bytes, but one pilot */
+/* per bucket of keys that picks the slot of each key, and mark empty slots with INDEX_NONE instead. when  */
+/* mapped, control bytes and slots are in anonymous mappings rounded up to huge pages, see map()           */
+
+struct table
+{
+	uint8_t *ctrl;
+	uint32_t *pilots;
+	uint32_t *index;
+	size_t n;
+	size_t n_deleted;
+	size_t n_alloc;
+	size_t n_pilots;
+	enum cdict_probing probing;
+	bool mapped;
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct section
+{
+	void *data;
+	size_t n;
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* arrays of SHARE_MIN bytes or more are anonymous mappings of their own. the first time one gets cloned,   */
+/* it moves into a memory file, the store, that all dictionaries of the process share. its pages are handed */
+/* out by ranges, from the end of the file so that they are never reused, and each page counts the spans    */
+/* that show it. pages no span shows anymore get punched out of the file, and the file is closed once no    */
+/* range is left of it. stores are only handled under store_lock                                            */
+
+struct store
+{
+	size_t refs;
+	size_t n;
+	size_t n_alloc;
+	size_t fence;
+	size_t forks;
+	size_t page;
+	int fd;
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct range
+{
+	struct store *store;
+	size_t offset;
+	size_t n;
+	size_t n_used;
+	unsigned refs[];
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct span
+{
+	struct range *range;
+	size_t first;
+	size_t n;
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* a region is an array mapped on its own. it is anonymous until first cloned, then both its dictionary and */
+/* the clone map it privately from spans of pages of the store laid end to end, and the kernel copies the   */
+/* pages either side writes to                                                                              */
+
+struct region
+{
+	struct region *next;
+	char *data;
+	struct span *spans;
+	size_t n_spans;
+	size_t n;
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+enum stage
+{
+	STAGE_HASH,
+	STAGE_FILL,
+	STAGE_INSERT,
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* bulk builds give each worker a slice of the keys to hash, and a range of hashtable groups to fill with */
+/* the entries whose home group falls in it. counts holds how many keys of the slice go to each range     */
+
+struct worker
+{
+	cdict *dict;
+	const char *const *keys;
+	const size_t *groups;
+	const size_t *values;
+	uint32_t *order;
+	size_t *counts;
+	size_t n_workers;
+	size_t first;
+	size_t last;
+	size_t g_last;
+	size_t o_first;
+	size_t o_last;
+	size_t n_chars;
+	size_t n_inserted;
+	size_t n_left;
+	pthread_t thread;
+	enum stage stage;
+	bool spawned;
+	bool overflow;
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* entries are appended in insertion order and shared by both hashtables during a resize. their fields are */
+/* split in separate arrays so that probes only touch hashes. groups take WIDTH() bytes, and values take   */
+/* VALUE_WIDTH() bytes, which are the whole payload in dictionaries created with a value size. erased      */
+/* entries are only flagged in the live bitmap until the next compaction. big arrays are regions, see      */
+/* acquire()                                                                                               */
+
+struct cdict
+{
+	struct table table;
+	struct table old;
+	uint64_t *hashes;
+	void *values;
+	void *groups;
+	uint64_t *live;
+	struct key *keys;
+	struct link *links;
+	struct chain *chains;
+	char *chars;
+	struct readers *readers;
+	struct sampler *sampler;
+	struct region *regions;
+	cbloom *bloom;
+	void *image;
+	size_t n_image;
+	size_t n_entries;
+	size_t n_entries_alloc;
+	size_t n_chars;
+	size_t n_chars_dead;
+	size_t n_chars_alloc;
+	size_t n_chains;
+	size_t n_chains_alloc;
+	size_t migrated;
+	size_t step;
+	size_t reserved;
+	size_t n_grows;
+	size_t value_size;
+	double max_load;
+	unsigned int flags;
+	enum cdict_hash hash;
+	uint64_t seed;
+	uint64_t t_grows;
+	enum cerr err;
+};
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static void          *acquire           (cdict *, size_t)                                               CDICT_NONNULL(1);
+static size_t         bucket            (const struct table *, uint64_t)                                CDICT_NONNULL(1) CDICT_PURE;
+static void           bloom_fill        (const cdict *, cbloom *)                                       CDICT_NONNULL(1, 2);
+static void           build             (struct worker *, size_t)                                       CDICT_NONNULL(1);
+static void           build_fill        (struct worker *)                                               CDICT_NONNULL(1);
+static void           build_hash        (struct worker *)                                               CDICT_NONNULL(1);
+static void           build_insert      (struct worker *)                                               CDICT_NONNULL(1);
+static size_t         build_probe       (const struct worker *, const struct cdict_key *)               CDICT_NONNULL(1, 2) CDICT_PURE;
+static size_t         build_range       (const struct table *, uint64_t, size_t)                        CDICT_NONNULL(1) CDICT_PURE;
+static void          *build_run         (void *);
+static void           build_settle      (cdict *, const char *const *, size_t)                          CDICT_NONNULL(1, 2);
+static void           build_spawn       (struct worker *, size_t, enum stage)                           CDICT_NONNULL(1);
+static struct chain  *chain_add         (cdict *, size_t)                                               CDICT_NONNULL(1);
+static struct chain  *chain_find        (const cdict *, size_t)                                         CDICT_NONNULL(1) CDICT_PURE;
+static void           chain_link        (cdict *, size_t)                                               CDICT_NONNULL(1);
+static bool           chain_rehash      (cdict *, size_t)                                               CDICT_NONNULL(1);
+static void           chain_remove      (cdict *, struct chain *)                                       CDICT_NONNULL(1, 2);
+static bool           chain_reserve     (cdict *, size_t)                                               CDICT_NONNULL(1);
+static void           chain_unlink      (cdict *, size_t)                                               CDICT_NONNULL(1);
+static void           compact           (cdict *)                                                       CDICT_NONNULL(1);
+static void          *copy              (cdict *, const cdict *, const void *, size_t)                  CDICT_NONNULL(1, 2);
+static size_t         cuckoo_probes     (const struct table *, uint64_t, size_t)                        CDICT_NONNULL(1) CDICT_PURE;
+static size_t         distance          (const cdict *, const struct table *, size_t)                   CDICT_NONNULL(1, 2) CDICT_PURE;
+static void           drop              (cdict *, size_t)                                               CDICT_NONNULL(1);
+static size_t         entry_add         (cdict *, const struct cdict_key *, size_t, const void *)       CDICT_NONNULL(1, 2);
+static void           entry_erase       (cdict *, size_t)                                               CDICT_NONNULL(1);
+static void           entry_get         (const cdict *, size_t, struct cdict_entry *)                   CDICT_NONNULL(1, 3);
+static size_t         entry_next        (const cdict *, size_t)                                         CDICT_NONNULL(1) CDICT_PURE;
+static bool           entry_reserve     (cdict *, size_t)                                               CDICT_NONNULL(1);
+static void           erase             (const cdict *, struct table *, size_t)                         CDICT_NONNULL(1, 2);
+static void           erase_groups      (struct table *, size_t)                                        CDICT_NONNULL(1);
+static void           erase_robin_hood  (const cdict *, struct table *, size_t)                         CDICT_NONNULL(1, 2);
+static size_t         fetch             (const cdict *, const struct cdict_key *)                       CDICT_NONNULL(1, 2);
+static size_t         field_get         (const cdict *, const void *, size_t)                           CDICT_NONNULL(1, 2) CDICT_PURE;
+static void           field_set         (const cdict *, void *, size_t, size_t)                         CDICT_NONNULL(1, 2);
+static size_t         find              (const cdict *, const struct table *, const struct cdict_key *) CDICT_NONNULL(1, 2, 3) CDICT_PURE;
+static size_t         find_cuckoo       (const cdict *, const struct table *, const struct cdict_key *) CDICT_NONNULL(1, 2, 3) CDICT_PURE;
+static size_t         find_groups       (const cdict *, const struct table *, const struct cdict_key *) CDICT_NONNULL(1, 2, 3) CDICT_PURE;
+static size_t         find_perfect      (const cdict *, const struct table *, const struct cdict_key *) CDICT_NONNULL(1, 2, 3) CDICT_PURE;
+static size_t         find_robin_hood   (const cdict *, const struct table *, const struct cdict_key *) CDICT_NONNULL(1, 2, 3) CDICT_PURE;
+static unsigned       first_bit         (uint64_t)                                                      CDICT_PURE;
+static bool           freeze            (const cdict *, FILE *)                                         CDICT_NONNULL(1, 2);
+static bool           full              (const struct table *, size_t)                                  CDICT_NONNULL(1) CDICT_PURE;
+static size_t         group_next        (const cdict *, size_t, size_t)                                 CDICT_NONNULL(1) CDICT_PURE;
+static uint32_t       group_free        (const uint8_t *)                                               CDICT_NONNULL(1) CDICT_PURE;
+static uint32_t       group_match       (const uint8_t *, uint8_t)                                      CDICT_NONNULL(1) CDICT_PURE;
+static bool           grow              (cdict *, size_t)                                               CDICT_NONNULL(1);
+static size_t         hint              (const cdict *, uint64_t)                                       CDICT_NONNULL(1) CDICT_PURE;
+static size_t         home              (const struct table *, uint64_t)                                CDICT_NONNULL(1) CDICT_PURE;
+static size_t         home_alt          (const struct table *, uint64_t)                                CDICT_NONNULL(1) CDICT_PURE;
+static bool           insert            (const cdict *, struct table *, size_t)                         CDICT_NONNULL(1, 2);
+static size_t         insert_cuckoo     (const cdict *, struct table *, uint64_t)                       CDICT_NONNULL(1, 2);
+static size_t         insert_groups     (struct table *, uint64_t)                                      CDICT_NONNULL(1);
+static size_t         insert_robin_hood (const cdict *, struct table *, uint64_t)                       CDICT_NONNULL(1, 2);
+static bool           key_match         (const char *, struct key, struct cdict_key)                    CDICT_PURE;
+static uint32_t       key_prefix        (const char *, size_t)                                          CDICT_NONNULL(1) CDICT_PURE;
+static bool           key_reserve       (cdict *, size_t)                                               CDICT_NONNULL(1);
+static struct key     key_store         (cdict *, const char *, size_t)                                 CDICT_NONNULL(1);
+static struct layout  layout            (const struct frozen *)                                         CDICT_NONNULL(1) CDICT_PURE;
+static size_t         locate            (const cdict *, const struct table *, size_t)                   CDICT_NONNULL(1, 2) CDICT_PURE;
+static size_t         lookup            (const cdict *, const struct cdict_key *)                       CDICT_NONNULL(1, 2) CDICT_PURE;
+static void          *map               (size_t);
+static bool           migrate           (cdict *, size_t)                                               CDICT_NONNULL(1);
+static uint32_t       pilot_search      (const struct table *, const uint64_t *, size_t, uint64_t *)    CDICT_NONNULL(1, 2, 4);
+static size_t         place             (const struct table *, uint64_t, uint32_t)                      CDICT_NONNULL(1) CDICT_PURE;
+static size_t         probes            (const cdict *, const struct table *, const struct cdict_key *) CDICT_NONNULL(1, 2, 3) CDICT_PURE;
+static struct range  *range_create      (struct store *, size_t)                                        CDICT_NONNULL(1);
+static void           range_drop        (struct range *, size_t, size_t)                                CDICT_NONNULL(1);
+static void           range_take        (struct range *, size_t, size_t)                                CDICT_NONNULL(1);
+static const cdict   *read_begin        (const cdict *, atomic_size_t **)                               CDICT_NONNULL(1, 2);
+static void           read_end          (atomic_size_t *);
+static bool           readers_bloom     (struct readers *, const cbloom *)                              CDICT_NONNULL(1);
+static bool           readers_init      (cdict *)                                                       CDICT_NONNULL(1);
+static void           readers_switch    (struct readers *, cdict *)                                     CDICT_NONNULL(1, 2);
+static void           readers_sync      (cdict *)                                                       CDICT_NONNULL(1);
+static void           readers_wait      (struct readers *, size_t)                                      CDICT_NONNULL(1);
+static void          *region_clone      (cdict *, struct region *)                                      CDICT_NONNULL(1, 2);
+static struct region *region_find       (const cdict *, const void *)                                   CDICT_NONNULL(1) CDICT_PURE;
+static size_t         region_runs       (bool *, size_t, size_t)                                        CDICT_NONNULL(1);
+static bool           region_scan       (const struct region *, size_t, bool *)                         CDICT_NONNULL(1, 3);
+static bool           region_settle     (struct region *, struct store *)                               CDICT_NONNULL(1, 2);
+static bool           rehash            (cdict *, size_t, enum cdict_probing)                           CDICT_NONNULL(1);
+static bool           rehash_perfect    (cdict *)                                                       CDICT_NONNULL(1);
+static void           release           (cdict *, void *)                                               CDICT_NONNULL(1);
+static cdict         *replicate         (const cdict *)                                                 CDICT_NONNULL(1);
+static void          *resize            (cdict *, void *, size_t, size_t, size_t)                       CDICT_NONNULL(1);
+static void           sample            (const cdict *, bool)                                           CDICT_NONNULL(1);
+static bool           sampler_init      (cdict *, size_t)                                               CDICT_NONNULL(1);
+static void           sections          (const cdict *, struct section *)                               CDICT_NONNULL(1, 2);
+static void           shrink            (cdict *, size_t, size_t)                                       CDICT_NONNULL(1);
+static void           stats_add         (const cdict *, struct cdict_stats *)                           CDICT_NONNULL(1, 2);
+static struct store  *store_create      (void);
+static void           store_drop        (struct store *)                                                CDICT_NONNULL(1);
+static void           store_fork        (void);
+static void           store_forked      (void);
+static struct store  *store_get         (void);
+static void           store_punch       (struct store *, size_t, size_t)                                CDICT_NONNULL(1);
+static void           store_retire      (void);
+static void           store_setup       (void);
+static bool           store_write       (struct store *, size_t, const char *, size_t)                  CDICT_NONNULL(1, 3);
+static bool           table_copy        (cdict *, const cdict *, struct table *, const struct table *)  CDICT_NONNULL(1, 2, 3, 4);
+static void           table_free        (cdict *, struct table *)                                       CDICT_NONNULL(1, 2);
+static bool           table_grow        (cdict *, struct table *)                                       CDICT_NONNULL(1, 2);
+static bool           table_init        (cdict *, struct table *, size_t)                               CDICT_NONNULL(1, 2);
+static size_t         thread_slot       (void);
+static void           tidy              (cdict *)                                                       CDICT_NONNULL(1);
+static void           unmap             (void *, size_t);
+static void           update            (cdict *, const struct cdict_key *, size_t, const void *)       CDICT_NONNULL(1, 2);
+static size_t         value_get         (const cdict *, size_t)                                         CDICT_NONNULL(1) CDICT_PURE;
+static void           value_move        (const cdict *, size_t, size_t)                                 CDICT_NONNULL(1);
+static void           value_set         (const cdict *, size_t, size_t, const void *)                   CDICT_NONNULL(1);
+static cdict         *write_begin       (cdict *)                                                       CDICT_NONNULL(1);
+static cdict         *write_next        (cdict *, cdict *)                                              CDICT_NONNULL(1, 2);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+cdict cdict_placeholder_instance =
+{
+	.table =
+	{
+		.ctrl      = NULL,
+		.pilots    = NULL,
+		.index     = NULL,
+		.n         = 0,
+		.n_deleted = 0,
+		.n_alloc   = 0,
+		.n_pilots  = 0,
+		.probing   = CDICT_PROBE_GROUPS,
+		.mapped    = false,
+	},
+	.old =
+	{
+		.ctrl      = NULL,
+		.pilots    = NULL,
+		.index     = NULL,
+		.n         = 0,
+		.n_deleted = 0,
+		.n_alloc   = 0,
+		.n_pilots  = 0,
+		.probing   = CDICT_PROBE_GROUPS,
+		.mapped    = false,
+	},
+	.hashes          = NULL,
+	.values          = NULL,
+	.groups          = NULL,
+	.live            = NULL,
+	.keys            = NULL,
+	.links           = NULL,
+	.chains          = NULL,
+	.chars           = NULL,
+	.readers         = NULL,
+	.sampler         = NULL,
+	.regions         = NULL,
+	.bloom           = NULL,
+	.image           = NULL,
+	.n_image         = 0,
+	.n_entries       = 0,
+	.n_entries_alloc = 0,
+	.n_chars         = 0,
+	.n_chars_dead    = 0,
+	.n_chars_alloc   = 0,
+	.n_chains        = 0,
+	.n_chains_alloc  = 0,
+	.migrated        = 0,
+	.step            = 0,
+	.reserved        = 0,
+	.n_grows         = 0,
+	.value_size      = 0,
+	.max_load        = 1.0,
+	.flags           = 0,
+	.hash            = CDICT_HASH_WY,
+	.seed            = 0,
+	.t_grows         = 0,
+	.err             = CERR_INVALID,
+};
+
+/* each thread sticks to one reader counter, threads past READER_SLOTS share theirs */
+
+static _Thread_local size_t reader_slot = NONE;
+static atomic_size_t reader_next = 0;
+
+/* new ranges come from the last store created. forks retire the stores a child inherits, see store_fork() */
+
+static pthread_mutex_t store_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t store_once = PTHREAD_ONCE_INIT;
+static struct store *store_last = NULL;
+static size_t store_forks = 0;
+static bool store_ready = false;
+
+/************************************************************************************************************/
+/* PUBLIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+void
+cdict_build(cdict *dict, const char *const *keys, const size_t *groups, const size_t *values, size_t n,
+            size_t threads)
+{
+	struct cdict_key k;
+	struct worker *workers;
+	uint32_t *order;
+	size_t *counts;
+	size_t stride;
+
+	if (dict->err || dict->image || n == 0)
+	{
+		return;
+	}
+
+	for (cdict *d = write_begin(dict); d; d = write_next(dict, d))
+	{
+		/* only empty dictionaries are built in parallel, the keys of others are written one by one */
+
+		if (d->n_entries > 0 || d->old.n_alloc > 0)
+		{
+			for (size_t i = 0; i < n && !d->err; i++)
+			{
+				k = cdict_hash(d, keys[i], strlen(keys[i]), groups[i]);
+				update(d, &k, values[i], NULL);
+			}
+		}
+		else if (n > INDEX_MAX || n > SIZE_MAX * d->max_load || !safe_mul(NULL, n, sizeof(uint64_t)))
+		{
+			d->err = CERR_OVERFLOW;
+		}
+		else
+		{
+			threads = threads < n / BUILD_SLICE ? threads : n / BUILD_SLICE;
+			threads = threads < BUILD_THREADS   ? threads : BUILD_THREADS;
+			threads = threads > 0 ? threads : 1;
+
+			/* counters of different workers are a cache line apart */
+
+			stride  = threads + CACHE_LINE / sizeof(size_t);
+			workers = calloc(threads, sizeof(struct worker));
+			counts  = calloc(threads * stride, sizeof(size_t));
+			order   = malloc(n * sizeof(uint32_t));
+
+			if (workers && counts && order)
+			{
+				for (size_t t = 0; t < threads; t++)
+				{
+					workers[t].dict      = d;
+					workers[t].keys      = keys;
+					workers[t].groups    = groups;
+					workers[t].values    = values;
+					workers[t].order     = order;
+					workers[t].counts    = counts + t * stride;
+					workers[t].n_workers = threads;
+					workers[t].first     = (uint64_t)n * t / threads;
+					workers[t].last      = (uint64_t)n * (t + 1) / threads;
+				}
+				build(workers, threads);
+				if (d->bloom)
+				{
+					bloom_fill(d, d->bloom);
+				}
+			}
+			else
+			{
+				d->err = CERR_MEMORY;
+			}
+
+			free(workers);
+			free(counts);
+			free(order);
+		}
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_clear(cdict *dict)
+{
+	if (dict->err || dict->image)
+	{
+		return;
+	}
+
+	for (cdict *d = write_begin(dict); d; d = write_next(dict, d))
+	{
+		table_free(d, &d->old);
+
+		if (d->table.probing == CDICT_PROBE_PERFECT)
+		{
+			memset(d->table.index, 0xFF, d->table.n_alloc * sizeof(uint32_t));
+		}
+		else
+		{
+			memset(d->table.ctrl, CTRL_EMPTY, d->table.n_alloc);
+		}
+
+		memset(d->live, 0, (d->n_entries + 63) / 64 * sizeof(uint64_t));
+
+		d->table.n         = 0;
+		d->table.n_deleted = 0;
+		d->n_entries       = 0;
+		d->n_chars         = 0;
+		d->n_chars_dead    = 0;
+		d->n_chains        = 0;
+
+		if (d->chains)
+		{
+			memset(d->chains, 0, d->n_chains_alloc * sizeof(struct chain));
+		}
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_clear_group(cdict *dict, size_t group)
+{
+	if (dict->err || dict->image)
+	{
+		return;
+	}
+
+	for (cdict *d = write_begin(dict); d; d = write_next(dict, d))
+	{
+		/* the next entry is still reachable from a dropped one */
+
+		for (size_t e = group_next(d, group, 0); e != NONE; e = group_next(d, group, e + 1))
+		{
+			drop(d, e);
+		}
+
+		tidy(d);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cdict *
+cdict_clone(const cdict *dict)
+{
+	cdict *dict_new;
+
+	if (dict->err || (dict_new = replicate(dict)) == CDICT_PLACEHOLDER)
+	{
+		return CDICT_PLACEHOLDER;
+	}
+
+	if (dict->readers && !readers_init(dict_new))
+	{
+		cdict_destroy(dict_new);
+		return CDICT_PLACEHOLDER;
+	}
+
+	return dict_new;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cdict *
+cdict_create(void)
+{
+	return cdict_create_with_flags(0);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cdict *
+cdict_create_with_flags(unsigned int flags)
+{
+	cdict *dict;
+
+	if (flags & ~(unsigned int)(CDICT_STORE_KEYS | CDICT_INDEX_GROUPS | CDICT_CONCURRENT_READS
+	                          | CDICT_COMPACT_VALUES | CDICT_HUGE_PAGES)
+	 || !(dict = calloc(1, sizeof(cdict))))
+	{
+		return CDICT_PLACEHOLDER;
+	}
+
+	dict->table.probing = CDICT_PROBE_GROUPS;
+	dict->migrated      = 0;
+	dict->step          = 0;
+	dict->reserved      = 0;
+	dict->max_load      = 0.6;
+	dict->flags         = flags;
+	dict->hash          = CDICT_HASH_WY;
+	dict->seed          = hash_seed();
+	dict->err           = CERR_NONE;
+
+	if (!table_init(dict, &dict->table, GROUP_WIDTH)
+	 || !entry_reserve(dict, GROUP_WIDTH)
+	 || (flags & CDICT_CONCURRENT_READS && !readers_init(dict)))
+	{
+		cdict_destroy(dict);
+		return CDICT_PLACEHOLDER;
+	}
+
+	return dict;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cdict *
+cdict_create_with_value_size(size_t bytes)
+{
+	cdict *dict;
+	void *values;
+
+	if (bytes == 0 || (dict = cdict_create()) == CDICT_PLACEHOLDER)
+	{
+		return CDICT_PLACEHOLDER;
+	}
+
+	/* the entry arrays were first sized for plain values, which are all still unset */
+
+	if (!safe_mul(NULL, dict->n_entries_alloc, bytes)
+	 || !(values = resize(dict, dict->values, 0, dict->n_entries_alloc, bytes)))
+	{
+		cdict_destroy(dict);
+		return CDICT_PLACEHOLDER;
+	}
+
+	dict->values     = values;
+	dict->value_size = bytes;
+
+	return dict;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_destroy(cdict *dict)
+{
+	if (dict == CDICT_PLACEHOLDER)
+	{
+		return;
+	}
+
+	if (dict->image)
+	{
+		munmap(dict->image, dict->n_image);
+	}
+	else
+	{
+		table_free(dict, &dict->table);
+		table_free(dict, &dict->old);
+		release(dict, dict->hashes);
+		release(dict, dict->values);
+		release(dict, dict->groups);
+		release(dict, dict->live);
+		release(dict, dict->keys);
+		release(dict, dict->links);
+		release(dict, dict->chains);
+		release(dict, dict->chars);
+	}
+
+	if (dict->readers)
+	{
+		readers_bloom(dict->readers, NULL);
+		cdict_destroy(dict->readers->twin);
+	}
+
+	free(dict->readers);
+	free(dict->sampler);
+	free(dict);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_erase(cdict *dict, const char *key, size_t group)
+{
+	cdict_erase_n(dict, key, strlen(key), group);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_erase_hashed(cdict *dict, struct cdict_key key)
+{
+	size_t i;
+
+	if (dict->err || dict->image)
+	{
+		return;
+	}
+
+	for (cdict *d = write_begin(dict); d; d = write_next(dict, d))
+	{
+		migrate(d, d->step);
+
+		if ((i = find(d, &d->table, &key)) != NONE)
+		{
+			entry_erase(d, d->table.index[i]);
+			erase(d, &d->table, i);
+		}
+		else if (d->old.n_alloc > 0 && (i = find(d, &d->old, &key)) != NONE)
+		{
+			entry_erase(d, d->old.index[i]);
+			erase(d, &d->old, i);
+		}
+
+		tidy(d);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_erase_n(cdict *dict, const char *key, size_t length, size_t group)
+{
+	cdict_erase_hashed(dict, cdict_hash(dict, key, length, group));
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+enum cerr
+cdict_error(const cdict *dict)
+{
+	return dict->err;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_fill_bloom(const cdict *dict, cbloom *bloom)
+{
+	atomic_size_t *reader;
+
+	dict = read_begin(dict, &reader);
+
+	if (!dict->err)
+	{
+		bloom_fill(dict, bloom);
+	}
+
+	read_end(reader);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cdict_find(const cdict *dict, const char *key, size_t group, size_t *value)
+{
+	return cdict_find_n(dict, key, strlen(key), group, value);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+cdict_find_batch(const cdict *dict, const char *const *keys, const size_t *groups, size_t n, size_t *values,
+                 bool *found)
+{
+	struct cdict_key k[BATCH_WIDTH];
+	bool pass[BATCH_WIDTH];
+	atomic_size_t *reader;
+	size_t n_found = 0;
+	size_t m;
+	size_t h;
+	size_t e;
+
+	dict = read_begin(dict, &reader);
+
+	if (dict->err)
+	{
+		read_end(reader);
+		if (found)
+		{
+			memset(found, 0, n * sizeof(bool));
+		}
+		return 0;
+	}
+
+	/* hash a batch of keys and prefetch their home slots (or pilots), then their likely entries, so that  */
+	/* cache misses overlap. prefetches stay inline, compilers treat them as side-effect free and drop     */
+	/* calls to helpers. keys ruled out by an attached bloom filter are skipped from the start             */
+
+	for (size_t i = 0; i < n; i += m)
+	{
+		m = n - i < BATCH_WIDTH ? n - i : BATCH_WIDTH;
+		for (size_t j = 0; j < m; j++)
+		{
+			k[j]    = cdict_hash(dict, keys[i + j], strlen(keys[i + j]), groups[i + j]);
+			pass[j] = !dict->bloom || cbloom_test(dict->bloom, k[j].hash);
+			if (!pass[j])
+			{
+				continue;
+			}
+			if (dict->table.pilots)
+			{
+				PREFETCH(dict->table.pilots + bucket(&dict->table, k[j].hash));
+			}
+			else
+			{
+				h = home(&dict->table, k[j].hash);
+				PREFETCH(dict->table.ctrl  + h);
+				PREFETCH(dict->table.index + h);
+			}
+			if (dict->table.probing == CDICT_PROBE_CUCKOO)
+			{
+				h = home_alt(&dict->table, k[j].hash);
+				PREFETCH(dict->table.ctrl  + h);
+				PREFETCH(dict->table.index + h);
+			}
+		}
+		for (size_t j = 0; j < m; j++)
+		{
+			if (pass[j] && (e = hint(dict, k[j].hash)) != NONE)
+			{
+				PREFETCH(dict->hashes + e);
+				PREFETCH((const char*)dict->values + e * VALUE_WIDTH(dict));
+				if (dict->keys)
+				{
+					PREFETCH(dict->keys + e);
+				}
+			}
+		}
+		for (size_t j = 0; j < m; j++)
+		{
+			e = pass[j] ? lookup(dict, k + j) : NONE;
+			sample(dict, e != NONE);
+			if (e != NONE)
+			{
+				n_found++;
+				if (values)
+				{
+					values[i + j] = value_get(dict, e);
+				}
+			}
+			if (found)
+			{
+				found[i + j] = e != NONE;
+			}
+		}
+	}
+
+	read_end(reader);
+
+	return n_found;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cdict_find_hashed(const cdict *dict, struct cdict_key key, size_t *value)
+{
+	atomic_size_t *reader;
+	size_t e;
+
+	dict = read_begin(dict, &reader);
+	if ((e = fetch(dict, &key)) != NONE && value)
+	{
+		*value = value_get(dict, e);
+	}
+	read_end(reader);
+
+	return e != NONE;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cdict_find_n(const cdict *dict, const char *key, size_t length, size_t group, size_t *value)
+{
+	struct cdict_key k;
+	atomic_size_t *reader;
+	size_t e;
+
+	/* the hash function and seed are read from the front copy as well */
+
+	dict = read_begin(dict, &reader);
+	k    = cdict_hash(dict, key, length, group);
+	if ((e = fetch(dict, &k)) != NONE && value)
+	{
+		*value = value_get(dict, e);
+	}
+	read_end(reader);
+
+	return e != NONE;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+const void *
+cdict_find_ref(const cdict *dict, const char *key, size_t group)
+{
+	struct cdict_key k;
+	const void *ref = NULL;
+	atomic_size_t *reader;
+	size_t e;
+
+	dict = read_begin(dict, &reader);
+	k    = cdict_hash(dict, key, strlen(key), group);
+	if ((e = fetch(dict, &k)) != NONE)
+	{
+		ref = (const char*)dict->values + e * VALUE_WIDTH(dict);
+	}
+	read_end(reader);
+
+	return ref;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_finish_resize(cdict *dict)
+{
+	if (dict->err || dict->image)
+	{
+		return;
+	}
+
+	for (cdict *d = write_begin(dict); d; d = write_next(dict, d))
+	{
+		migrate(d, SIZE_MAX);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cdict_freeze_to_file(const cdict *dict, const char *path)
+{
+	cdict *tmp = NULL;
+	FILE *file = NULL;
+	char *path_tmp;
+	size_t length;
+	int fd = -1;
+	bool ok;
+
+	if (dict->err || !safe_add(&length, strlen(path), sizeof(".XXXXXX")) || !(path_tmp = malloc(length)))
+	{
+		return false;
+	}
+
+	/* images only hold live entries of a single hashtable, so others get dropped from a temporary copy */
+
+	if (dict->old.n_alloc > 0 || dict->n_entries > dict->table.n)
+	{
+		tmp = replicate(dict);
+		if (!tmp->err)
+		{
+			migrate(tmp, SIZE_MAX);
+			compact(tmp);
+		}
+		dict = tmp;
+	}
+
+	/* the image is swapped in whole so that processes mapping the previous one never see it half written, */
+	/* and made readable by all since temporary files are created only readable by their owner             */
+
+	snprintf(path_tmp, length, "%s.XXXXXX", path);
+
+	ok = !dict->err
+	  && (fd = mkstemp(path_tmp)) >= 0
+	  && fchmod(fd, 0644) == 0
+	  && (file = fdopen(fd, "wb"))
+	  && freeze(dict, file);
+
+	if (file)
+	{
+		ok = fclose(file) == 0 && ok;
+	}
+	else if (fd >= 0)
+	{
+		close(fd);
+	}
+
+	if (fd >= 0 && !(ok = ok && rename(path_tmp, path) == 0))
+	{
+		unlink(path_tmp);
+	}
+
+	if (tmp)
+	{
+		cdict_destroy(tmp);
+	}
+
+	free(path_tmp);
+
+	return ok;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+cdict_group_length(const cdict *dict, size_t group)
+{
+	const struct chain *chain;
+	size_t n = 0;
+
+	if (dict->err)
+	{
+		return 0;
+	}
+
+	if (dict->links)
+	{
+		return (chain = chain_find(dict, group)) ? chain->n : 0;
+	}
+
+	for (size_t e = group_next(dict, group, 0); e != NONE; e = group_next(dict, group, e + 1))
+	{
+		n++;
+	}
+
+	return n;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct cdict_key
+cdict_hash(const cdict *dict, const char *key, size_t length, size_t group)
+{
+	struct cdict_key k;
+
+	k.str    = key;
+	k.length = length;
+	k.group  = group;
+
+	switch (dict->hash)
+	{
+		case CDICT_HASH_WY:
+			k.hash = hash_wy(key, length, group, dict->seed);
+			break;
+
+		case CDICT_HASH_FNV1A:
+			k.hash = hash_fnv1a(key, length, group, dict->seed);
+			break;
+
+		default:
+			k.hash = 0;
+			break;
+	}
+
+	return k;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+cdict_load(const cdict *dict)
+{
+	if (dict->err)
+	{
+		return 0;
+	}
+
+	return dict->table.n + dict->old.n;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+double
+cdict_load_factor(const cdict *dict)
+{
+	if (dict->err)
+	{
+		return 0.0;
+	}
+
+	return (double)(dict->table.n + dict->old.n) / dict->table.n_alloc;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cdict_next(const cdict *dict, size_t *iterator, struct cdict_entry *entry)
+{
+	size_t e;
+
+	if (dict->err || (e = entry_next(dict, *iterator)) == NONE)
+	{
+		return false;
+	}
+
+	entry_get(dict, e, entry);
+	*iterator = e + 1;
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cdict_next_in_group(const cdict *dict, size_t group, size_t *iterator, struct cdict_entry *entry)
+{
+	size_t e;
+
+	if (dict->err || (e = group_next(dict, group, *iterator)) == NONE)
+	{
+		return false;
+	}
+
+	entry_get(dict, e, entry);
+	*iterator = e + 1;
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cdict *
+cdict_open_frozen(const char *path)
+{
+	struct frozen head;
+	struct layout at;
+	struct stat st;
+	cdict *dict;
+	char *image;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+	{
+		return CDICT_PLACEHOLDER;
+	}
+
+	if (fstat(fd, &st) != 0
+	 || st.st_size < (off_t)sizeof(struct frozen)
+	 || (image = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)
+	{
+		close(fd);
+		return CDICT_PLACEHOLDER;
+	}
+
+	close(fd);
+
+	/* counts are bounded by the file size before computing the layout, so that offsets cannot overflow */
+
+	memcpy(&head, image, sizeof(struct frozen));
+
+	if (memcmp(head.magic, FROZEN_MAGIC, sizeof(FROZEN_MAGIC)) != 0
+	 || head.version    != FROZEN_VERSION
+	 || head.order      != FROZEN_ORDER
+	 || head.size_width != sizeof(size_t)
+	 || head.flags & ~(uint32_t)(CDICT_STORE_KEYS | CDICT_COMPACT_VALUES)
+	 || (head.hash != CDICT_HASH_WY && head.hash != CDICT_HASH_FNV1A)
+	 || (head.probing != CDICT_PROBE_GROUPS
+	  && head.probing != CDICT_PROBE_ROBIN_HOOD
+	  && head.probing != CDICT_PROBE_PERFECT
+	  && head.probing != CDICT_PROBE_CUCKOO)
+	 || head.size != (uint64_t)st.st_size
+	 || head.n_alloc    > head.size
+	 || head.n_pilots   > head.size
+	 || head.n_entries  > head.size
+	 || head.n_chars    > head.size
+	 || head.value_size > head.size
+	 || !safe_mul(NULL, head.n_entries, head.value_size)
+	 || (head.value_size && head.flags & CDICT_COMPACT_VALUES)
+	 || head.n_alloc == 0
+	 || (head.probing == CDICT_PROBE_PERFECT
+	  ? head.n_pilots == 0 || head.n_pilots > UINT32_MAX || head.n_alloc > PILOT_DIRECT
+	  : head.n_pilots != 0 || head.n_alloc % GROUP_WIDTH != 0)
+	 || head.n + head.n_deleted > head.n_alloc
+	 || head.n != head.n_entries
+	 || head.n_entries > INDEX_MAX
+	 || layout(&head).size != head.size
+	 || !(dict = calloc(1, sizeof(cdict))))
+	{
+		munmap(image, st.st_size);
+		return CDICT_PLACEHOLDER;
+	}
+
+	at = layout(&head);
+
+	dict->table.ctrl      = head.probing != CDICT_PROBE_PERFECT ? (uint8_t*)(image + at.ctrl) : NULL;
+	dict->table.pilots    = head.probing == CDICT_PROBE_PERFECT ? (uint32_t*)(image + at.pilots) : NULL;
+	dict->table.index     = (uint32_t*)(image + at.index);
+	dict->table.n         = head.n;
+	dict->table.n_deleted = head.n_deleted;
+	dict->table.n_alloc   = head.n_alloc;
+	dict->table.n_pilots  = head.n_pilots;
+	dict->table.probing   = head.probing;
+	dict->hashes          = (uint64_t*)(image + at.hashes);
+	dict->values          = image + at.values;
+	dict->groups          = image + at.groups;
+	dict->live            = (uint64_t*)(image + at.live);
+	dict->keys            = head.flags & CDICT_STORE_KEYS ? (struct key*)(image + at.keys) : NULL;
+	dict->chars           = head.flags & CDICT_STORE_KEYS ? image + at.chars : NULL;
+	dict->image           = image;
+	dict->n_image         = head.size;
+	dict->n_entries       = head.n_entries;
+	dict->n_entries_alloc = head.n_entries;
+	dict->n_chars         = head.n_chars;
+	dict->n_chars_alloc   = head.n_chars;
+	dict->value_size      = head.value_size;
+	dict->max_load        = 0.6;
+	dict->flags           = head.flags;
+	dict->hash            = head.hash;
+	dict->seed            = head.seed;
+	dict->err             = CERR_NONE;
+
+	return dict;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_prealloc(cdict *dict, size_t slots_number)
+{
+	if (dict->err || dict->image)
+	{
+		return;
+	}
+
+	for (cdict *d = write_begin(dict); d; d = write_next(dict, d))
+	{
+		if (slots_number > SIZE_MAX * d->max_load)
+		{
+			d->err = CERR_OVERFLOW;
+		}
+		else if (grow(d, slots_number / d->max_load) && slots_number > d->n_entries)
+		{
+			entry_reserve(d, slots_number - d->n_entries);
+		}
+
+		/* erasures never shrink the table below a preallocated size */
+
+		if (!d->err && slots_number / d->max_load > d->reserved)
+		{
+			d->reserved = slots_number / d->max_load;
+		}
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+cdict_probe_length(const cdict *dict, const char *key, size_t group)
+{
+	struct cdict_key k;
+	size_t n;
+
+	if (dict->err)
+	{
+		return 0;
+	}
+
+	k = cdict_hash(dict, key, strlen(key), group);
+	n = probes(dict, &dict->table, &k);
+
+	if (dict->old.n_alloc > 0 && find(dict, &dict->table, &k) == NONE)
+	{
+		n += probes(dict, &dict->old, &k);
+	}
+
+	return n;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_repair(cdict *dict)
+{
+	if (dict->err == CERR_INVALID)
+	{
+		return;
+	}
+
+	for (cdict *d = write_begin(dict); d; d = write_next(dict, d))
+	{
+		d->err = CERR_NONE;
+	}
+
+	/* a modification that failed on only one of the copies may have left them apart */
+
+	if (dict->readers && dict->readers->split)
+	{
+		readers_sync(dict);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+double
+cdict_resize_progress(const cdict *dict)
+{
+	if (dict->err || dict->old.n_alloc == 0)
+	{
+		return 1.0;
+	}
+
+	return (double)dict->migrated / dict->old.n_alloc;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_set_bloom(cdict *dict, cbloom *bloom)
+{
+	if (dict->err)
+	{
+		return;
+	}
+
+	/* frozen dictionaries can take a filter too, it is kept outside of their image */
+
+	for (cdict *d = write_begin(dict); d; d = write_next(dict, d))
+	{
+		if (bloom && cbloom_error(bloom))
+		{
+			d->err = CERR_PARAM;
+		}
+		else if (d == dict)
+		{
+			d->bloom = bloom;
+		}
+		else if (!readers_bloom(dict->readers, bloom))
+		{
+			d->err = CERR_MEMORY;
+		}
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_set_hash(cdict *dict, enum cdict_hash hash, uint64_t seed)
+{
+	if (dict->err || dict->image)
+	{
+		return;
+	}
+
+	for (cdict *d = write_begin(dict); d; d = write_next(dict, d))
+	{
+		if (d->table.n + d->old.n > 0 || (hash != CDICT_HASH_WY && hash != CDICT_HASH_FNV1A))
+		{
+			d->err = CERR_PARAM;
+		}
+		else
+		{
+			d->hash = hash;
+			d->seed = seed;
+		}
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_set_max_load(cdict *dict, double load_factor)
+{
+	size_t n;
+
+	if (dict->err || dict->image)
+	{
+		return;
+	}
+
+	for (cdict *d = write_begin(dict); d; d = write_next(dict, d))
+	{
+		n = d->table.n + d->old.n;
+
+		if (load_factor <= 0.0 || load_factor > 1.0)
+		{
+			d->err = CERR_PARAM;
+		}
+		else if (n > SIZE_MAX * load_factor)
+		{
+			d->err = CERR_OVERFLOW;
+		}
+		else
+		{
+			/* cuckoo insertions start failing past their own cap */
+			if (d->table.probing == CDICT_PROBE_CUCKOO && load_factor > CUCKOO_LOAD)
+			{
+				load_factor = CUCKOO_LOAD;
+			}
+			if (d->table.probing == CDICT_PROBE_PERFECT || grow(d, n / load_factor))
+			{
+				d->max_load = load_factor;
+			}
+		}
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_set_probing(cdict *dict, enum cdict_probing probing)
+{
+	size_t n;
+	size_t m;
+
+	if (dict->err || dict->image || dict->table.probing == probing)
+	{
+		return;
+	}
+
+	for (cdict *d = write_begin(dict); d; d = write_next(dict, d))
+	{
+		/* perfect tables are full, leaving them takes a table sized for the maximum load factor */
+
+		n = d->table.probing == CDICT_PROBE_PERFECT ? d->table.n / d->max_load + 1 : d->table.n_alloc;
+
+		switch (probing)
+		{
+			case CDICT_PROBE_GROUPS:
+			case CDICT_PROBE_ROBIN_HOOD:
+				rehash(d, n, probing);
+				break;
+
+			case CDICT_PROBE_PERFECT:
+				rehash_perfect(d);
+				break;
+
+			case CDICT_PROBE_CUCKOO:
+				d->max_load = d->max_load < CUCKOO_LOAD ? d->max_load : CUCKOO_LOAD;
+				m = (d->table.n + d->old.n) / d->max_load + 1;
+				rehash(d, n > m ? n : m, probing);
+				break;
+
+			default:
+				d->err = CERR_PARAM;
+				break;
+		}
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_set_resize_step(cdict *dict, size_t slots_number)
+{
+	if (dict->err || dict->image)
+	{
+		return;
+	}
+
+	for (cdict *d = write_begin(dict); d; d = write_next(dict, d))
+	{
+		d->step = slots_number;
+
+		if (d->step == 0)
+		{
+			migrate(d, SIZE_MAX);
+		}
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_set_sampling(cdict *dict, size_t period)
+{
+	if (dict->err)
+	{
+		return;
+	}
+
+	for (cdict *d = write_begin(dict); d; d = write_next(dict, d))
+	{
+		free(d->sampler);
+
+		d->sampler = NULL;
+
+		if (period > 0 && !sampler_init(d, period))
+		{
+			d->err = CERR_MEMORY;
+		}
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_shrink_to_fit(cdict *dict)
+{
+	size_t n;
+
+	if (dict->err || dict->image)
+	{
+		return;
+	}
+
+	for (cdict *d = write_begin(dict); d; d = write_next(dict, d))
+	{
+		n = d->table.n + d->old.n;
+
+		d->reserved = 0;
+
+		shrink(d, n / d->max_load + 1, n);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct cdict_stats
+cdict_stats(const cdict *dict)
+{
+	const struct table *tables[] = {&dict->table, &dict->old};
+	struct cdict_stats stats     = {0};
+	const struct table *table;
+	size_t n_probes = 0;
+	size_t n_slots  = 0;
+	size_t n        = 0;
+	size_t d;
+	size_t p;
+
+	if (dict->err)
+	{
+		return stats;
+	}
+
+	/* a full slot's displacement is counted from its key's home slot, which is also where probes start. */
+	/* cuckoo keys are instead displaced by whole buckets, the stash being a third one                   */
+
+	for (size_t t = 0; t < 2; t++)
+	{
+		table = tables[t];
+		for (size_t i = 0; i < table->n_alloc; i++)
+		{
+			if (!full(table, i))
+			{
+				continue;
+			}
+			if (table->probing == CDICT_PROBE_CUCKOO)
+			{
+				p = cuckoo_probes(table, dict->hashes[table->index[i]], i);
+				d = p - 1;
+			}
+			else
+			{
+				d = (i + table->n_alloc - home(table, dict->hashes[table->index[i]])) % table->n_alloc;
+				p = table->probing == CDICT_PROBE_GROUPS ? d / GROUP_WIDTH + 1 : d + 1;
+			}
+			stats.probes[p < CDICT_STATS_PROBES ? p - 1 : CDICT_STATS_PROBES - 1]++;
+			stats.probes_max       = p > stats.probes_max       ? p : stats.probes_max;
+			stats.displacement_max = d > stats.displacement_max ? d : stats.displacement_max;
+			n_probes += p;
+			n_slots  += d;
+			n++;
+		}
+	}
+
+	if (n > 0)
+	{
+		stats.probes_mean       = (double)n_probes / n;
+		stats.displacement_mean = (double)n_slots  / n;
+	}
+
+	/* the twin of a concurrent dictionary takes as much memory, and samples the lookups made while in front */
+
+	stats_add(dict, &stats);
+
+	if (dict->readers)
+	{
+		stats_add(dict->readers->twin, &stats);
+		stats.bytes += sizeof(struct readers);
+	}
+
+	stats.tombstones = dict->table.n_deleted + dict->old.n_deleted;
+	stats.grows      = dict->n_grows;
+	stats.grow_time  = dict->t_grows / 1e9;
+
+	return stats;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_write(cdict *dict, const char *key, size_t group, size_t value)
+{
+	cdict_write_n(dict, key, strlen(key), group, value);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_write_hashed(cdict *dict, struct cdict_key key, size_t value)
+{
+	if (dict->err || dict->image)
+	{
+		return;
+	}
+
+	for (cdict *d = write_begin(dict); d; d = write_next(dict, d))
+	{
+		update(d, &key, value, NULL);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_write_n(cdict *dict, const char *key, size_t length, size_t group, size_t value)
+{
+	cdict_write_hashed(dict, cdict_hash(dict, key, length, group), value);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cdict_write_ref(cdict *dict, const char *key, size_t group, const void *value)
+{
+	struct cdict_key k;
+
+	if (dict->err || dict->image)
+	{
+		return;
+	}
+
+	k = cdict_hash(dict, key, strlen(key), group);
+
+	for (cdict *d = write_begin(dict); d; d = write_next(dict, d))
+	{
+		update(d, &k, 0, value);
+	}
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static void *
+acquire(cdict *dict, size_t n)
+{
+	const size_t page = sysconf(_SC_PAGESIZE);
+	struct region *region;
+	char *data;
+
+	/* big arrays get mappings of their own so that a clone can move them to the store in place. either */
+	/* way, the memory comes zeroed                                                                     */
+
+	if (n < SHARE_MIN || !safe_add(NULL, n, page) || !(region = malloc(sizeof(struct region))))
+	{
+		return calloc(n, 1);
+	}
+
+	n = (n + page - 1) / page * page;
+
+	if ((data = mmap(NULL, n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+	{
+		free(region);
+		return calloc(n, 1);
+	}
+
+	region->data    = data;
+	region->spans   = NULL;
+	region->n_spans = 0;
+	region->n       = n;
+	region->next    = dict->regions;
+	dict->regions   = region;
+
+	return data;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+bucket(const struct table *table, uint64_t hash)
+{
+	/* scales the top half of the hash to the bucket count with a multiplication instead of a division */
+
+	return (hash >> 32) * table->n_pilots >> 32;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+bloom_fill(const cdict *dict, cbloom *bloom)
+{
+	for (size_t e = entry_next(dict, 0); e != NONE; e = entry_next(dict, e + 1))
+	{
+		cbloom_add(bloom, dict->hashes[e]);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+build(struct worker *workers, size_t n_workers)
+{
+	enum cdict_probing probing;
+	cdict *dict = workers->dict;
+	size_t n    = workers[n_workers - 1].last;
+	size_t n_groups;
+	size_t n_chars = 0;
+	size_t o       = 0;
+	size_t m;
+	bool overflow = false;
+
+	/* the hashtable is sized upfront so that it never grows, and perfect tables are built with group */
+	/* probing first. the entry arrays get exactly one entry per key, duplicates included             */
+
+	probing = dict->table.probing;
+	m       = n / dict->max_load + 1;
+
+	if ((probing == CDICT_PROBE_PERFECT || dict->table.n_alloc < m || dict->table.n_deleted > 0)
+	 && !rehash(dict, m, probing == CDICT_PROBE_PERFECT ? CDICT_PROBE_GROUPS : probing))
+	{
+		return;
+	}
+
+	if (!migrate(dict, SIZE_MAX) || !entry_reserve(dict, n))
+	{
+		return;
+	}
+
+	n_groups = dict->table.n_alloc / GROUP_WIDTH;
+
+	for (size_t t = 0; t < n_workers; t++)
+	{
+		workers[t].g_last = ((uint64_t)n_groups * (t + 1) + n_workers - 1) / n_workers;
+	}
+
+	build_spawn(workers, n_workers, STAGE_HASH);
+
+	/* each slice's keys are packed after those of the previous slices, and each range's entries are */
+	/* ordered by slice, so that both keep the input order                                            */
+
+	for (size_t t = 0; t < n_workers; t++)
+	{
+		m                  = workers[t].n_chars;
+		workers[t].n_chars = n_chars;
+		overflow          |= workers[t].overflow || !safe_add(&n_chars, n_chars, m);
+	}
+
+	for (size_t r = 0; r < n_workers; r++)
+	{
+		workers[r].o_first = o;
+		for (size_t t = 0; t < n_workers; t++)
+		{
+			m                     = workers[t].counts[r];
+			workers[t].counts[r]  = o;
+			o                    += m;
+		}
+		workers[r].o_last = o;
+	}
+
+	if (overflow)
+	{
+		dict->err = CERR_OVERFLOW;
+		return;
+	}
+
+	if (dict->keys && !key_reserve(dict, n_chars))
+	{
+		dict->err = CERR_MEMORY;
+		return;
+	}
+
+	build_spawn(workers, n_workers, STAGE_FILL);
+
+	memset(dict->live, 0xFF, n / 64 * sizeof(uint64_t));
+	if (n % 64 > 0)
+	{
+		dict->live[n / 64] = ((uint64_t)1 << n % 64) - 1;
+	}
+
+	dict->n_entries = n;
+	dict->n_chars   = n_chars;
+
+	for (size_t e = 0; e < n && dict->links; e++)
+	{
+		if (!chain_reserve(dict, 1))
+		{
+			dict->err = CERR_MEMORY;
+			return;
+		}
+		chain_link(dict, e);
+	}
+
+	/* robin hood inserts shift slots across ranges, so their entries are all inserted by the calling thread */
+
+	if (dict->table.probing == CDICT_PROBE_GROUPS)
+	{
+		build_spawn(workers, n_workers, STAGE_INSERT);
+		for (size_t r = 0; r < n_workers; r++)
+		{
+			dict->table.n += workers[r].n_inserted;
+			for (size_t j = workers[r].o_first; j < workers[r].o_first + workers[r].n_left; j++)
+			{
+				build_settle(dict, workers->keys, workers->order[j]);
+			}
+		}
+	}
+	else
+	{
+		for (size_t e = 0; e < n; e++)
+		{
+			build_settle(dict, workers->keys, e);
+		}
+	}
+
+	if (probing == CDICT_PROBE_PERFECT)
+	{
+		rehash_perfect(dict);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+build_fill(struct worker *w)
+{
+	cdict *dict    = w->dict;
+	size_t n_chars = w->n_chars;
+	size_t r;
+
+	/* counts now hold where the slice's next entry of each range goes */
+
+	for (size_t e = w->first; e < w->last; e++)
+	{
+		if (dict->keys)
+		{
+			memcpy(dict->chars + n_chars, w->keys[e], dict->keys[e].length);
+			dict->keys[e].offset  = n_chars;
+			n_chars              += dict->keys[e].length;
+		}
+		r = build_range(&dict->table, dict->hashes[e], w->n_workers);
+		w->order[w->counts[r]++] = e;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+build_hash(struct worker *w)
+{
+	struct cdict_key k;
+	cdict *dict    = w->dict;
+	size_t n_chars = 0;
+	bool overflow  = false;
+
+	for (size_t e = w->first; e < w->last; e++)
+	{
+		k = cdict_hash(dict, w->keys[e], strlen(w->keys[e]), w->groups[e]);
+		dict->hashes[e] = k.hash;
+		value_set(dict, e, w->values[e], NULL);
+		field_set(dict, dict->groups, e, w->groups[e]);
+		if (dict->keys)
+		{
+			dict->keys[e].length = k.length;
+			dict->keys[e].prefix = key_prefix(k.str, k.length);
+			overflow |= k.length > UINT32_MAX || !safe_add(&n_chars, n_chars, k.length);
+		}
+		if (dict->flags & CDICT_COMPACT_VALUES)
+		{
+			overflow |= w->values[e] > UINT32_MAX || w->groups[e] > UINT32_MAX;
+		}
+		w->counts[build_range(&dict->table, k.hash, w->n_workers)]++;
+	}
+
+	w->n_chars  = n_chars;
+	w->overflow = overflow;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+build_insert(struct worker *w)
+{
+	struct cdict_key k;
+	cdict *dict   = w->dict;
+	size_t n_left = 0;
+	size_t n      = 0;
+	size_t e;
+	size_t i;
+
+	/* keys that are already in the range, or that would have to be placed past its end, are moved to the */
+	/* front of the range's order for the calling thread to settle once all workers are done              */
+
+	for (size_t j = w->o_first; j < w->o_last; j++)
+	{
+		e        = w->order[j];
+		k.hash   = dict->hashes[e];
+		k.group  = field_get(dict, dict->groups, e);
+		k.str    = w->keys[e];
+		k.length = dict->keys ? dict->keys[e].length : 0;
+		if ((i = build_probe(w, &k)) != NONE)
+		{
+			dict->table.ctrl[i]  = TAG(k.hash);
+			dict->table.index[i] = (uint32_t)e;
+			n++;
+		}
+		else
+		{
+			w->order[w->o_first + n_left++] = e;
+		}
+	}
+
+	w->n_inserted = n;
+	w->n_left     = n_left;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+build_probe(const struct worker *w, const struct cdict_key *key)
+{
+	const struct table *table = &w->dict->table;
+	const cdict *dict         = w->dict;
+	const uint8_t *ctrl;
+	uint32_t mask;
+	size_t e;
+
+	/* same probe as find_groups() and insert_groups() combined, stopped at the end of the range */
+
+	for (size_t g = key->hash % (table->n_alloc / GROUP_WIDTH); g < w->g_last; g++)
+	{
+		ctrl = table->ctrl + g * GROUP_WIDTH;
+		for (mask = group_match(ctrl, TAG(key->hash)); mask; mask &= mask - 1)
+		{
+			e = table->index[g * GROUP_WIDTH + first_bit(mask)];
+			if (dict->hashes[e] == key->hash
+			 && (!dict->keys || key_match(dict->chars, dict->keys[e], *key)))
+			{
+				return NONE;
+			}
+		}
+		if ((mask = group_free(ctrl)))
+		{
+			return g * GROUP_WIDTH + first_bit(mask);
+		}
+	}
+
+	return NONE;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+build_range(const struct table *table, uint64_t hash, size_t n_workers)
+{
+	size_t n_groups = table->n_alloc / GROUP_WIDTH;
+
+	return hash % n_groups * n_workers / n_groups;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void *
+build_run(void *arg)
+{
+	struct worker *w = arg;
+
+	switch (w->stage)
+	{
+		case STAGE_HASH:
+			build_hash(w);
+			break;
+
+		case STAGE_FILL:
+			build_fill(w);
+			break;
+
+		case STAGE_INSERT:
+			build_insert(w);
+			break;
+	}
+
+	return NULL;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+build_settle(cdict *dict, const char *const *keys, size_t e)
+{
+	struct cdict_key k;
+	size_t j;
+
+	k.hash   = dict->hashes[e];
+	k.group  = field_get(dict, dict->groups, e);
+	k.str    = keys[e];
+	k.length = dict->keys ? dict->keys[e].length : 0;
+
+	/* a later duplicate only passes its value on to the first entry of its key, like a write would */
+
+	if ((j = lookup(dict, &k)) != NONE)
+	{
+		value_move(dict, j, e);
+		entry_erase(dict, e);
+	}
+	else if (!insert(dict, &dict->table, e))
+	{
+		dict->err = CERR_OVERFLOW;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+build_spawn(struct worker *workers, size_t n, enum stage stage)
+{
+	/* the calling thread runs the first worker, and those whose thread could not be created */
+
+	for (size_t i = 0; i < n; i++)
+	{
+		workers[i].stage   = stage;
+		workers[i].spawned = i > 0 && pthread_create(&workers[i].thread, NULL, build_run, workers + i) == 0;
+	}
+
+	build_run(workers);
+
+	for (size_t i = 1; i < n; i++)
+	{
+		if (workers[i].spawned)
+		{
+			pthread_join(workers[i].thread, NULL);
+		}
+		else
+		{
+			build_run(workers + i);
+		}
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static struct chain *
+chain_add(cdict *dict, size_t group)
+{
+	size_t i;
+
+	i = hash_mix(group, CHAIN_MIX) % dict->n_chains_alloc;
+
+	while (dict->chains[i].n > 0 && dict->chains[i].group != group)
+	{
+		if (++i >= dict->n_chains_alloc)
+		{
+			i = 0;
+		}
+	}
+
+	if (dict->chains[i].n == 0)
+	{
+		dict->chains[i].group = group;
+		dict->chains[i].first = NONE;
+		dict->chains[i].last  = NONE;
+		dict->n_chains++;
+	}
+
+	return dict->chains + i;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static struct chain *
+chain_find(const cdict *dict, size_t group)
+{
+	size_t i;
+
+	if (dict->n_chains == 0)
+	{
+		return NULL;
+	}
+
+	i = hash_mix(group, CHAIN_MIX) % dict->n_chains_alloc;
+
+	while (dict->chains[i].n > 0)
+	{
+		if (dict->chains[i].group == group)
+		{
+			return dict->chains + i;
+		}
+		if (++i >= dict->n_chains_alloc)
+		{
+			i = 0;
+		}
+	}
+
+	return NULL;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+chain_link(cdict *dict, size_t e)
+{
+	struct chain *chain;
+
+	chain = chain_add(dict, field_get(dict, dict->groups, e));
+
+	dict->links[e].prev = chain->last;
+	dict->links[e].next = NONE;
+
+	if (chain->last != NONE)
+	{
+		dict->links[chain->last].next = e;
+	}
+	else
+	{
+		chain->first = e;
+	}
+
+	chain->last = e;
+	chain->n++;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+chain_rehash(cdict *dict, size_t n)
+{
+	struct chain *chains;
+	struct chain *chains_old;
+	size_t n_old;
+
+	if (!(chains = acquire(dict, n * sizeof(struct chain))))
+	{
+		return false;
+	}
+
+	chains_old           = dict->chains;
+	n_old                = dict->n_chains_alloc;
+	dict->chains         = chains;
+	dict->n_chains       = 0;
+	dict->n_chains_alloc = n;
+
+	for (size_t i = 0; i < n_old; i++)
+	{
+		if (chains_old[i].n > 0)
+		{
+			*chain_add(dict, chains_old[i].group) = chains_old[i];
+		}
+	}
+
+	release(dict, chains_old);
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+chain_remove(cdict *dict, struct chain *chain)
+{
+	size_t i;
+	size_t j;
+	size_t h;
+
+	i = chain - dict->chains;
+
+	/* shift back the following chains that are allowed to, so that no tombstones are needed */
+
+	for (j = (i + 1) % dict->n_chains_alloc; dict->chains[j].n > 0; j = (j + 1) % dict->n_chains_alloc)
+	{
+		h = hash_mix(dict->chains[j].group, CHAIN_MIX) % dict->n_chains_alloc;
+		if (i < j ? h <= i || h > j : h <= i && h > j)
+		{
+			dict->chains[i] = dict->chains[j];
+			i = j;
+		}
+	}
+
+	dict->chains[i].n = 0;
+	dict->n_chains--;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+chain_reserve(cdict *dict, size_t n)
+{
+	if (!safe_add(&n, dict->n_chains, n) || !safe_mul(&n, n, 2))
+	{
+		return false;
+	}
+
+	return n <= dict->n_chains_alloc || chain_rehash(dict, n > GROUP_WIDTH ? n : GROUP_WIDTH);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+chain_unlink(cdict *dict, size_t e)
+{
+	struct chain *chain;
+
+	chain = chain_find(dict, field_get(dict, dict->groups, e));
+
+	if (dict->links[e].prev != NONE)
+	{
+		dict->links[dict->links[e].prev].next = dict->links[e].next;
+	}
+	else
+	{
+		chain->first = dict->links[e].next;
+	}
+
+	if (dict->links[e].next != NONE)
+	{
+		dict->links[dict->links[e].next].prev = dict->links[e].prev;
+	}
+	else
+	{
+		chain->last = dict->links[e].prev;
+	}
+
+	if (--chain->n == 0)
+	{
+		chain_remove(dict, chain);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+compact(cdict *dict)
+{
+	bool perfect   = dict->table.probing == CDICT_PROBE_PERFECT;
+	size_t n       = 0;
+	size_t n_chars = 0;
+
+	/* live entries and their keys get packed to the front in the same order, which renumbers them, so  */
+	/* chains and the hashtable are rebuilt from scratch. it's only done when there's no ongoing resize */
+	/* perfect tables cannot be rebuilt entry by entry, their slots get renumbered in place instead     */
+
+	for (size_t e = entry_next(dict, 0); e != NONE; e = entry_next(dict, e + 1), n++)
+	{
+		if (perfect)
+		{
+			dict->table.index[locate(dict, &dict->table, e)] = n;
+		}
+		dict->hashes[n] = dict->hashes[e];
+		value_move(dict, n, e);
+		field_set(dict, dict->groups, n, field_get(dict, dict->groups, e));
+		if (dict->keys)
+		{
+			memmove(dict->chars + n_chars, dict->chars + dict->keys[e].offset, dict->keys[e].length);
+			dict->keys[n]        = dict->keys[e];
+			dict->keys[n].offset = n_chars;
+			n_chars             += dict->keys[n].length;
+		}
+	}
+
+	memset(dict->live, 0, (dict->n_entries + 63) / 64 * sizeof(uint64_t));
+
+	dict->n_entries    = n;
+	dict->n_chars      = n_chars;
+	dict->n_chars_dead = 0;
+	dict->n_chains     = 0;
+
+	if (!perfect)
+	{
+		memset(dict->table.ctrl, CTRL_EMPTY, dict->table.n_alloc);
+		dict->table.n         = 0;
+		dict->table.n_deleted = 0;
+	}
+
+	if (dict->chains)
+	{
+		memset(dict->chains, 0, dict->n_chains_alloc * sizeof(struct chain));
+	}
+
+	for (size_t e = 0; e < n; e++)
+	{
+		dict->live[e / 64] |= (uint64_t)1 << e % 64;
+		if (dict->links)
+		{
+			chain_link(dict, e);
+		}
+		if (!perfect && !insert(dict, &dict->table, e))
+		{
+			dict->err = CERR_OVERFLOW;
+		}
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void *
+copy(cdict *dict, const cdict *src, const void *ptr, size_t n)
+{
+	struct region *region;
+	void *dst;
+
+	if (!ptr)
+	{
+		return NULL;
+	}
+
+	if ((region = region_find(src, ptr)) && (dst = region_clone(dict, region)))
+	{
+		return dst;
+	}
+
+	if ((dst = acquire(dict, n)))
+	{
+		memcpy(dst, ptr, n);
+	}
+
+	return dst;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+cuckoo_probes(const struct table *table, uint64_t hash, size_t i)
+{
+	/* buckets read to reach slot i, the stash counts as a third one */
+
+	if (i >= table->n_alloc - CUCKOO_STASH)
+	{
+		return 3;
+	}
+
+	return i / CUCKOO_WAYS * CUCKOO_WAYS == home(table, hash) ? 1 : 2;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+distance(const cdict *dict, const struct table *table, size_t i)
+{
+	if (table->ctrl[i] < CTRL_FAR)
+	{
+		return table->ctrl[i] - 1;
+	}
+
+	return (i + table->n_alloc - dict->hashes[table->index[i]] % table->n_alloc) % table->n_alloc;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+drop(cdict *dict, size_t e)
+{
+	size_t i;
+
+	if ((i = locate(dict, &dict->table, e)) != NONE)
+	{
+		erase(dict, &dict->table, i);
+	}
+	else if (dict->old.n_alloc > 0 && (i = locate(dict, &dict->old, e)) != NONE)
+	{
+		erase(dict, &dict->old, i);
+	}
+
+	entry_erase(dict, e);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+entry_add(cdict *dict, const struct cdict_key *key, size_t value, const void *ref)
+{
+	size_t e;
+
+	e = dict->n_entries++;
+
+	dict->hashes[e]     = key->hash;
+	dict->live[e / 64] |= (uint64_t)1 << e % 64;
+
+	value_set(dict, e, value, ref);
+	field_set(dict, dict->groups, e, key->group);
+
+	if (dict->keys)
+	{
+		dict->keys[e] = key_store(dict, key->str, key->length);
+	}
+
+	if (dict->links)
+	{
+		chain_link(dict, e);
+	}
+
+	return e;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+entry_erase(cdict *dict, size_t e)
+{
+	dict->live[e / 64] &= ~((uint64_t)1 << e % 64);
+
+	if (dict->keys)
+	{
+		dict->n_chars_dead += dict->keys[e].length;
+	}
+
+	if (dict->links)
+	{
+		chain_unlink(dict, e);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+entry_get(const cdict *dict, size_t e, struct cdict_entry *entry)
+{
+	entry->key    = dict->keys ? dict->chars + dict->keys[e].offset : NULL;
+	entry->length = dict->keys ? dict->keys[e].length : 0;
+	entry->group  = field_get(dict, dict->groups, e);
+	entry->value  = value_get(dict, e);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+entry_next(const cdict *dict, size_t e)
+{
+	uint64_t word;
+
+	/* skips erased entries 64 at a time, bits past the last entry are never set */
+
+	while (e < dict->n_entries)
+	{
+		if ((word = dict->live[e / 64] >> e % 64))
+		{
+			return e + first_bit(word);
+		}
+		e += 64 - e % 64;
+	}
+
+	return NONE;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+entry_reserve(cdict *dict, size_t n)
+{
+	struct key *keys;
+	struct link *links;
+	uint64_t *hashes;
+	uint64_t *live;
+	void *values;
+	void *groups;
+	size_t words_old;
+	size_t words;
+	size_t n_old;
+	size_t m;
+
+	/* entries are referenced by 32-bit indices */
+
+	if (!safe_add(&n, dict->n_entries, n) || n > INDEX_MAX)
+	{
+		dict->err = CERR_OVERFLOW;
+		return false;
+	}
+
+	if (n <= dict->n_entries_alloc)
+	{
+		return true;
+	}
+
+	m = dict->n_entries_alloc < INDEX_MAX / 2 ? dict->n_entries_alloc * 2 : INDEX_MAX;
+	n = n > m ? n : m;
+	n = n > GROUP_WIDTH ? n : GROUP_WIDTH;
+
+	if (!safe_mul(NULL, n, sizeof(uint64_t)) || !safe_mul(NULL, n, VALUE_WIDTH(dict)))
+	{
+		dict->err = CERR_OVERFLOW;
+		return false;
+	}
+
+	n_old     = dict->n_entries_alloc;
+	words_old = (n_old + 63) / 64;
+	words     = (n + 63) / 64;
+
+	if (!(hashes = resize(dict, dict->hashes, n_old, n, sizeof(uint64_t))))
+	{
+		dict->err = CERR_MEMORY;
+		return false;
+	}
+
+	dict->hashes = hashes;
+
+	if (!(values = resize(dict, dict->values, n_old, n, VALUE_WIDTH(dict))))
+	{
+		dict->err = CERR_MEMORY;
+		return false;
+	}
+
+	dict->values = values;
+
+	if (!(groups = resize(dict, dict->groups, n_old, n, WIDTH(dict))))
+	{
+		dict->err = CERR_MEMORY;
+		return false;
+	}
+
+	dict->groups = groups;
+
+	if (!(live = resize(dict, dict->live, words_old, words, sizeof(uint64_t))))
+	{
+		dict->err = CERR_MEMORY;
+		return false;
+	}
+
+	dict->live = live;
+	memset(dict->live + words_old, 0, (words - words_old) * sizeof(uint64_t));
+
+	if (dict->flags & CDICT_STORE_KEYS)
+	{
+		if (!(keys = resize(dict, dict->keys, n_old, n, sizeof(struct key))))
+		{
+			dict->err = CERR_MEMORY;
+			return false;
+		}
+		dict->keys = keys;
+	}
+
+	if (dict->flags & CDICT_INDEX_GROUPS)
+	{
+		if (!(links = resize(dict, dict->links, n_old, n, sizeof(struct link))))
+		{
+			dict->err = CERR_MEMORY;
+			return false;
+		}
+		dict->links = links;
+	}
+
+	dict->n_entries_alloc = n;
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+erase(const cdict *dict, struct table *table, size_t i)
+{
+	switch (table->probing)
+	{
+		case CDICT_PROBE_GROUPS:
+			erase_groups(table, i);
+			break;
+
+		case CDICT_PROBE_ROBIN_HOOD:
+			erase_robin_hood(dict, table, i);
+			break;
+
+		case CDICT_PROBE_PERFECT:
+			table->index[i] = INDEX_NONE;
+			break;
+
+		case CDICT_PROBE_CUCKOO:
+			table->ctrl[i] = CTRL_EMPTY;
+			break;
+	}
+
+	table->n--;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+erase_groups(struct table *table, size_t i)
+{
+	/* a group with an empty slot was never full, no probe went past it so no tombstone is needed */
+
+	if (group_match(table->ctrl + i - i % GROUP_WIDTH, CTRL_EMPTY))
+	{
+		table->ctrl[i] = CTRL_EMPTY;
+	}
+	else
+	{
+		table->ctrl[i] = CTRL_DELETED;
+		table->n_deleted++;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+erase_robin_hood(const cdict *dict, struct table *table, size_t i)
+{
+	size_t j;
+	size_t d;
+
+	/* shift back the following displaced slots instead of leaving a tombstone */
+
+	for (j = (i + 1) % table->n_alloc; table->ctrl[j] != CTRL_EMPTY; j = (j + 1) % table->n_alloc)
+	{
+		if ((d = distance(dict, table, j)) == 0)
+		{
+			break;
+		}
+		table->index[i] = table->index[j];
+		table->ctrl[i]  = DIST(d - 1);
+		i = j;
+	}
+
+	table->ctrl[i] = CTRL_EMPTY;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+fetch(const cdict *dict, const struct cdict_key *key)
+{
+	size_t e;
+
+	if (dict->err)
+	{
+		return NONE;
+	}
+
+	/* most missing keys are answered by the bloom filter without probing the table */
+
+	e = dict->bloom && !cbloom_test(dict->bloom, key->hash) ? NONE : lookup(dict, key);
+
+	sample(dict, e != NONE);
+
+	return e;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+field_get(const cdict *dict, const void *array, size_t e)
+{
+	if (dict->flags & CDICT_COMPACT_VALUES)
+	{
+		return ((const uint32_t*)array)[e];
+	}
+
+	return ((const size_t*)array)[e];
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+field_set(const cdict *dict, void *array, size_t e, size_t value)
+{
+	if (dict->flags & CDICT_COMPACT_VALUES)
+	{
+		((uint32_t*)array)[e] = value;
+	}
+	else
+	{
+		((size_t*)array)[e] = value;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+find(const cdict *dict, const struct table *table, const struct cdict_key *key)
+{
+	switch (table->probing)
+	{
+		case CDICT_PROBE_GROUPS:
+			return find_groups(dict, table, key);
+
+		case CDICT_PROBE_ROBIN_HOOD:
+			return find_robin_hood(dict, table, key);
+
+		case CDICT_PROBE_PERFECT:
+			return find_perfect(dict, table, key);
+
+		case CDICT_PROBE_CUCKOO:
+			return find_cuckoo(dict, table, key);
+	}
+
+	return NONE;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+find_cuckoo(const cdict *dict, const struct table *table, const struct cdict_key *key)
+{
+	size_t first[3];
+	size_t e;
+
+	/* keys can only be in one of their 2 buckets, or in the stash */
+
+	first[0] = home(table, key->hash);
+	first[1] = home_alt(table, key->hash);
+	first[2] = table->n_alloc - CUCKOO_STASH;
+
+	for (size_t j = 0; j < 3; j++)
+	{
+		for (size_t i = first[j]; i < first[j] + (j < 2 ? CUCKOO_WAYS : CUCKOO_STASH); i++)
+		{
+			if (table->ctrl[i] != TAG(key->hash))
+			{
+				continue;
+			}
+			e = table->index[i];
+			if (dict->hashes[e] == key->hash
+			 && (!dict->keys || key_match(dict->chars, dict->keys[e], *key)))
+			{
+				return i;
+			}
+		}
+	}
+
+	return NONE;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+find_groups(const cdict *dict, const struct table *table, const struct cdict_key *key)
+{
+	const uint8_t *ctrl;
+	uint32_t mask;
+	size_t n_groups;
+	size_t g;
+	size_t i;
+	size_t e;
+
+	n_groups = table->n_alloc / GROUP_WIDTH;
+	g        = key->hash % n_groups;
+
+	for (size_t j = 0; j < n_groups; j++)
+	{
+		ctrl = table->ctrl + g * GROUP_WIDTH;
+		for (mask = group_match(ctrl, TAG(key->hash)); mask; mask &= mask - 1)
+		{
+			i = g * GROUP_WIDTH + first_bit(mask);
+			e = table->index[i];
+			if (dict->hashes[e] == key->hash
+			 && (!dict->keys || key_match(dict->chars, dict->keys[e], *key)))
+			{
+				return i;
+			}
+		}
+		if (group_match(ctrl, CTRL_EMPTY))
+		{
+			return NONE;
+		}
+		if (++g >= n_groups)
+		{
+			g = 0;
+		}
+	}
+
+	return NONE;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+find_perfect(const cdict *dict, const struct table *table, const struct cdict_key *key)
+{
+	size_t i;
+	size_t e;
+
+	/* a key can only be in its own slot, which may hold another key if it wasn't part of the table's build */
+
+	i = home(table, key->hash);
+	e = table->index[i];
+
+	if (e != INDEX_NONE
+	 && dict->hashes[e] == key->hash
+	 && (!dict->keys || key_match(dict->chars, dict->keys[e], *key)))
+	{
+		return i;
+	}
+
+	return NONE;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+find_robin_hood(const cdict *dict, const struct table *table, const struct cdict_key *key)
+{
+	size_t i;
+	size_t e;
+	size_t d_i;
+
+	i = key->hash % table->n_alloc;
+
+	/* a matching slot has to be exactly as far from its home as the probe, others need no entry access */
+
+	for (size_t d = 0; d < table->n_alloc; d++)
+	{
+		if (table->ctrl[i] == CTRL_EMPTY || (d_i = distance(dict, table, i)) < d)
+		{
+			return NONE;
+		}
+		e = table->index[i];
+		if (d_i == d
+		 && dict->hashes[e] == key->hash
+		 && (!dict->keys || key_match(dict->chars, dict->keys[e], *key)))
+		{
+			return i;
+		}
+		if (++i >= table->n_alloc)
+		{
+			i = 0;
+		}
+	}
+
+	return NONE;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static unsigned
+first_bit(uint64_t mask)
+{
+#if __GNUC__ > 4
+	return __builtin_ctzll(mask);
+#else
+	unsigned i = 0;
+
+	for (; !(mask & 1); mask >>= 1)
+	{
+		i++;
+	}
+
+	return i;
+#endif
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+freeze(const cdict *dict, FILE *file)
+{
+	static const char zeros[CACHE_LINE] = {0};
+
+	struct frozen head =
+	{
+		.magic      = FROZEN_MAGIC,
+		.version    = FROZEN_VERSION,
+		.order      = FROZEN_ORDER,
+		.size_width = sizeof(size_t),
+		.flags      = (dict->flags & CDICT_COMPACT_VALUES) | (dict->keys ? CDICT_STORE_KEYS : 0),
+		.hash       = dict->hash,
+		.probing    = dict->table.probing,
+		.seed       = dict->seed,
+		.n_alloc    = dict->table.n_alloc,
+		.n_pilots   = dict->table.n_pilots,
+		.n          = dict->table.n,
+		.n_deleted  = dict->table.n_deleted,
+		.n_entries  = dict->n_entries,
+		.n_chars    = dict->n_chars,
+		.value_size = dict->value_size,
+	};
+
+	struct layout at = layout(&head);
+
+	const struct
+	{
+		const void *data;
+		size_t offset;
+		size_t n;
+	}
+	sections[] =
+	{
+		{&head,               0,          sizeof(struct frozen)},
+		{dict->table.ctrl,    at.ctrl,    dict->table.ctrl ? head.n_alloc : 0},
+		{dict->table.pilots,  at.pilots,  head.n_pilots * sizeof(uint32_t)},
+		{dict->table.index,   at.index,   head.n_alloc * sizeof(uint32_t)},
+		{dict->hashes,        at.hashes,  head.n_entries * sizeof(uint64_t)},
+		{dict->values,        at.values,  head.n_entries * VALUE_WIDTH(dict)},
+		{dict->groups,        at.groups,  head.n_entries * WIDTH(dict)},
+		{dict->live,          at.live,    (head.n_entries + 63) / 64 * sizeof(uint64_t)},
+		{dict->keys,          at.keys,    dict->keys ? head.n_entries * sizeof(struct key) : 0},
+		{dict->chars,         at.chars,   dict->keys ? head.n_chars : 0},
+	};
+
+	size_t n = 0;
+
+	head.size = at.size;
+
+	for (size_t i = 0; i < sizeof(sections) / sizeof(*sections); i++)
+	{
+		if (fwrite(zeros, 1, sections[i].offset - n, file) != sections[i].offset - n
+		 || (sections[i].n > 0 && fwrite(sections[i].data, 1, sections[i].n, file) != sections[i].n))
+		{
+			return false;
+		}
+		n = sections[i].offset + sections[i].n;
+	}
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+full(const struct table *table, size_t i)
+{
+	switch (table->probing)
+	{
+		case CDICT_PROBE_GROUPS:
+		case CDICT_PROBE_CUCKOO:
+			return table->ctrl[i] & CTRL_FULL;
+
+		case CDICT_PROBE_ROBIN_HOOD:
+			return table->ctrl[i] != CTRL_EMPTY;
+
+		case CDICT_PROBE_PERFECT:
+			return table->index[i] != INDEX_NONE;
+	}
+
+	return false;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static uint32_t
+group_free(const uint8_t *ctrl)
+{
+#if defined(__SSE2__)
+	return ~_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl)) & 0xFFFF;
+#else
+	uint32_t mask = 0;
+
+	for (size_t i = 0; i < GROUP_WIDTH; i++)
+	{
+		mask |= (uint32_t)!(ctrl[i] & CTRL_FULL) << i;
+	}
+
+	return mask;
+#endif
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static uint32_t
+group_match(const uint8_t *ctrl, uint8_t byte)
+{
+#if defined(__SSE2__)
+	__m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+	__m128i match = _mm_set1_epi8((char)byte);
+
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(group, match));
+#else
+	uint32_t mask = 0;
+
+	for (size_t i = 0; i < GROUP_WIDTH; i++)
+	{
+		mask |= (uint32_t)(ctrl[i] == byte) << i;
+	}
+
+	return mask;
+#endif
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+group_next(const cdict *dict, size_t group, size_t e)
+{
+	const struct chain *chain;
+
+	/* e is 0 to get the first entry of the group, or the previous entry + 1 */
+
+	if (dict->links)
+	{
+		if (e == 0)
+		{
+			return (chain = chain_find(dict, group)) ? chain->first : NONE;
+		}
+		return dict->links[e - 1].next;
+	}
+
+	for (e = entry_next(dict, e); e != NONE && field_get(dict, dict->groups, e) != group; e = entry_next(dict, e + 1));
+
+	return e;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+grow(cdict *dict, size_t n)
+{
+	enum cdict_probing probing = dict->table.probing;
+	struct timespec t0;
+	struct timespec t1;
+	bool ok;
+
+	if (n <= dict->table.n_alloc)
+	{
+		return true;
+	}
+
+	/* perfect tables cannot take new keys, growing them brings back group probing. the time spent moving */
+	/* slots a few at each write after an incremental resize is not accounted for                         */
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	ok = rehash(dict, n, probing == CDICT_PROBE_PERFECT ? CDICT_PROBE_GROUPS : probing);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	dict->n_grows++;
+	dict->t_grows += (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000 + t1.tv_nsec - t0.tv_nsec;
+
+	return ok;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+hint(const cdict *dict, uint64_t hash)
+{
+	uint32_t mask;
+	size_t h;
+
+	/* entry of the first slot a lookup is likely to match, without probing further than the home slot */
+
+	h = home(&dict->table, hash);
+
+	switch (dict->table.probing)
+	{
+		case CDICT_PROBE_GROUPS:
+			mask = group_match(dict->table.ctrl + h, TAG(hash));
+			return mask ? dict->table.index[h + first_bit(mask)] : NONE;
+
+		case CDICT_PROBE_ROBIN_HOOD:
+			return dict->table.ctrl[h] != CTRL_EMPTY ? dict->table.index[h] : NONE;
+
+		case CDICT_PROBE_PERFECT:
+			return dict->table.index[h] != INDEX_NONE ? dict->table.index[h] : NONE;
+
+		case CDICT_PROBE_CUCKOO:
+			for (size_t i = h; i < h + CUCKOO_WAYS; i++)
+			{
+				if (dict->table.ctrl[i] == TAG(hash))
+				{
+					return dict->table.index[i];
+				}
+			}
+			return NONE;
+	}
+
+	return NONE;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+home(const struct table *table, uint64_t hash)
+{
+	switch (table->probing)
+	{
+		case CDICT_PROBE_GROUPS:
+			return hash % (table->n_alloc / GROUP_WIDTH) * GROUP_WIDTH;
+
+		case CDICT_PROBE_ROBIN_HOOD:
+			return hash % table->n_alloc;
+
+		case CDICT_PROBE_PERFECT:
+			return place(table, hash, table->pilots[bucket(table, hash)]);
+
+		case CDICT_PROBE_CUCKOO:
+			return hash % ((table->n_alloc - CUCKOO_STASH) / CUCKOO_WAYS) * CUCKOO_WAYS;
+	}
+
+	return 0;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+home_alt(const struct table *table, uint64_t hash)
+{
+	size_t n_buckets;
+	size_t b1;
+	size_t b2;
+
+	/* second bucket of a cuckoo key, always distinct from the first one */
+
+	n_buckets = (table->n_alloc - CUCKOO_STASH) / CUCKOO_WAYS;
+	b1        = hash % n_buckets;
+	b2        = hash_mix(hash, CUCKOO_MIX) % n_buckets;
+
+	return (b2 != b1 ? b2 : (b1 + 1) % n_buckets) * CUCKOO_WAYS;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+insert(const cdict *dict, struct table *table, size_t e)
+{
+	size_t i;
+
+	switch (table->probing)
+	{
+		case CDICT_PROBE_GROUPS:
+			i = insert_groups(table, dict->hashes[e]);
+			break;
+
+		case CDICT_PROBE_ROBIN_HOOD:
+			i = insert_robin_hood(dict, table, dict->hashes[e]);
+			break;
+
+		case CDICT_PROBE_CUCKOO:
+			i = insert_cuckoo(dict, table, dict->hashes[e]);
+			break;
+
+		default:
+			return true;
+	}
+
+	if (i == NONE)
+	{
+		return false;
+	}
+
+	table->index[i] = (uint32_t)e;
+	table->n++;
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+insert_cuckoo(const cdict *dict, struct table *table, uint64_t hash)
+{
+	size_t slots[CUCKOO_PATH];
+	size_t parents[CUCKOO_PATH];
+	size_t n = 0;
+	size_t i;
+	size_t j;
+	size_t b;
+	uint64_t h;
+
+	/* the 8 slots of both buckets are the roots of a breadth first search for the shortest chain of */
+	/* entries that can each be pushed to their other bucket, ending on a free slot                 */
+
+	for (b = home(table, hash); n < 2 * CUCKOO_WAYS; b = home_alt(table, hash))
+	{
+		for (i = b; i < b + CUCKOO_WAYS; i++, n++)
+		{
+			if (!(table->ctrl[i] & CTRL_FULL))
+			{
+				table->ctrl[i] = TAG(hash);
+				return i;
+			}
+			slots[n]   = i;
+			parents[n] = NONE;
+		}
+	}
+
+	for (size_t p = 0; p < n && n + CUCKOO_WAYS <= CUCKOO_PATH; p++)
+	{
+		h = dict->hashes[table->index[slots[p]]];
+		b = home(table, h);
+		b = slots[p] - slots[p] % CUCKOO_WAYS == b ? home_alt(table, h) : b;
+		for (i = b; i < b + CUCKOO_WAYS; i++)
+		{
+			/* a slot already on the path would get its entry moved twice */
+			for (j = p; j != NONE && slots[j] != i; j = parents[j]);
+			if (j != NONE)
+			{
+				continue;
+			}
+			if (table->ctrl[i] & CTRL_FULL)
+			{
+				slots[n]     = i;
+				parents[n++] = p;
+				continue;
+			}
+			/* entries shift one step along the path, from the free slot back up to a root slot */
+			for (j = p; j != NONE; i = slots[j], j = parents[j])
+			{
+				table->ctrl[i]  = table->ctrl[slots[j]];
+				table->index[i] = table->index[slots[j]];
+			}
+			table->ctrl[i] = TAG(hash);
+			return i;
+		}
+	}
+
+	/* no short enough chain, the key goes to the stash as a last resort */
+
+	for (i = table->n_alloc - CUCKOO_STASH; i < table->n_alloc; i++)
+	{
+		if (!(table->ctrl[i] & CTRL_FULL))
+		{
+			table->ctrl[i] = TAG(hash);
+			return i;
+		}
+	}
+
+	return NONE;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+insert_groups(struct table *table, uint64_t hash)
+{
+	uint32_t mask;
+	size_t n_groups;
+	size_t g;
+	size_t i;
+
+	n_groups = table->n_alloc / GROUP_WIDTH;
+	g        = hash % n_groups;
+
+	while (!(mask = group_free(table->ctrl + g * GROUP_WIDTH)))
+	{
+		if (++g >= n_groups)
+		{
+			g = 0;
+		}
+	}
+
+	i = g * GROUP_WIDTH + first_bit(mask);
+
+	if (table->ctrl[i] == CTRL_DELETED)
+	{
+		table->n_deleted--;
+	}
+
+	table->ctrl[i] = TAG(hash);
+
+	return i;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+insert_robin_hood(const cdict *dict, struct table *table, uint64_t hash)
+{
+	size_t i;
+	size_t j;
+	size_t k;
+	size_t d;
+
+	i = hash % table->n_alloc;
+	d = 0;
+
+	/* take the place of the first slot closer to its home, and shift forward the rest of its cluster */
+
+	while (table->ctrl[i] != CTRL_EMPTY && distance(dict, table, i) >= d)
+	{
+		if (++i >= table->n_alloc)
+		{
+			i = 0;
+		}
+		d++;
+	}
+
+	for (j = i; table->ctrl[j] != CTRL_EMPTY; j = (j + 1) % table->n_alloc);
+
+	for (; j != i; j = k)
+	{
+		k = (j + table->n_alloc - 1) % table->n_alloc;
+		table->ctrl[j]  = DIST(distance(dict, table, k) + 1);
+		table->index[j] = table->index[k];
+	}
+
+	table->ctrl[i] = DIST(d);
+
+	return i;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+key_match(const char *chars, struct key k, struct cdict_key key)
+{
+	/* keys of up to 4 bytes are entirely held in their prefix, the arena only gets read for longer ones */
+
+	return k.length == key.length
+	    && k.prefix == key_prefix(key.str, key.length)
+	    && (key.length <= sizeof(k.prefix)
+	     || memcmp(chars + k.offset + sizeof(k.prefix), key.str + sizeof(k.prefix),
+	               key.length - sizeof(k.prefix)) == 0);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static uint32_t
+key_prefix(const char *str, size_t length)
+{
+	uint32_t prefix = 0;
+
+	memcpy(&prefix, str, length < sizeof(prefix) ? length : sizeof(prefix));
+
+	return prefix;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+key_reserve(cdict *dict, size_t length)
+{
+	size_t n;
+	char *tmp;
+
+	if (dict->chars && dict->n_chars + length <= dict->n_chars_alloc)
+	{
+		return true;
+	}
+
+	if (!safe_add(&n, dict->n_chars, length))
+	{
+		return false;
+	}
+
+	n = n > dict->n_chars_alloc * 2 ? n : dict->n_chars_alloc * 2;
+	n = n > 64 ? n : 64;
+
+	if (!(tmp = resize(dict, dict->chars, dict->n_chars_alloc, n, 1)))
+	{
+		return false;
+	}
+
+	dict->chars         = tmp;
+	dict->n_chars_alloc = n;
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static struct key
+key_store(cdict *dict, const char *str, size_t length)
+{
+	struct key key;
+
+	memcpy(dict->chars + dict->n_chars, str, length);
+
+	key.offset = dict->n_chars;
+	key.length = length;
+	key.prefix = key_prefix(str, length);
+
+	dict->n_chars += length;
+
+	return key;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static struct layout
+layout(const struct frozen *head)
+{
+	struct layout at;
+	size_t n_keys  = head->flags & CDICT_STORE_KEYS ? head->n_entries : 0;
+	size_t n_chars = head->flags & CDICT_STORE_KEYS ? head->n_chars   : 0;
+	size_t n_ctrl  = head->probing != CDICT_PROBE_PERFECT ? head->n_alloc : 0;
+	size_t width   = head->flags & CDICT_COMPACT_VALUES ? sizeof(uint32_t) : sizeof(size_t);
+	size_t v_width = head->value_size ? head->value_size : width;
+
+	at.ctrl   = ALIGN(sizeof(struct frozen));
+	at.pilots = ALIGN(at.ctrl   + n_ctrl);
+	at.index  = ALIGN(at.pilots + head->n_pilots * sizeof(uint32_t));
+	at.hashes = ALIGN(at.index  + head->n_alloc * sizeof(uint32_t));
+	at.values = ALIGN(at.hashes + head->n_entries * sizeof(uint64_t));
+	at.groups = ALIGN(at.values + head->n_entries * v_width);
+	at.live   = ALIGN(at.groups + head->n_entries * width);
+	at.keys   = ALIGN(at.live   + (head->n_entries + 63) / 64 * sizeof(uint64_t));
+	at.chars  = ALIGN(at.keys   + n_keys * sizeof(struct key));
+	at.size   = at.chars + n_chars;
+
+	return at;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+locate(const cdict *dict, const struct table *table, size_t e)
+{
+	uint64_t hash = dict->hashes[e];
+	uint32_t mask;
+	size_t i;
+	size_t n;
+
+	/* same as find(), but matches a given entry instead of a key */
+
+	switch (table->probing)
+	{
+		case CDICT_PROBE_GROUPS:
+			n = table->n_alloc / GROUP_WIDTH;
+			i = hash % n;
+			for (size_t j = 0; j < n; j++, i = (i + 1) % n)
+			{
+				for (mask = group_match(table->ctrl + i * GROUP_WIDTH, TAG(hash)); mask; mask &= mask - 1)
+				{
+					if (table->index[i * GROUP_WIDTH + first_bit(mask)] == e)
+					{
+						return i * GROUP_WIDTH + first_bit(mask);
+					}
+				}
+				if (group_match(table->ctrl + i * GROUP_WIDTH, CTRL_EMPTY))
+				{
+					return NONE;
+				}
+			}
+			return NONE;
+
+		case CDICT_PROBE_ROBIN_HOOD:
+			n = table->n_alloc;
+			i = hash % n;
+			for (size_t d = 0; d < n; d++, i = (i + 1) % n)
+			{
+				if (table->ctrl[i] == CTRL_EMPTY || distance(dict, table, i) < d)
+				{
+					return NONE;
+				}
+				if (table->index[i] == e)
+				{
+					return i;
+				}
+			}
+			return NONE;
+
+		case CDICT_PROBE_PERFECT:
+			i = home(table, hash);
+			return table->index[i] == e ? i : NONE;
+
+		case CDICT_PROBE_CUCKOO:
+			for (size_t j = 0; j < 3; j++)
+			{
+				i = j == 0 ? home(table, hash) : j == 1 ? home_alt(table, hash) : table->n_alloc - CUCKOO_STASH;
+				for (n = i + (j < 2 ? CUCKOO_WAYS : CUCKOO_STASH); i < n; i++)
+				{
+					if (table->ctrl[i] == TAG(hash) && table->index[i] == e)
+					{
+						return i;
+					}
+				}
+			}
+			return NONE;
+	}
+
+	return NONE;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+lookup(const cdict *dict, const struct cdict_key *key)
+{
+	size_t i;
+
+	if ((i = find(dict, &dict->table, key)) != NONE)
+	{
+		return dict->table.index[i];
+	}
+
+	if (dict->old.n_alloc > 0 && (i = find(dict, &dict->old, key)) != NONE)
+	{
+		return dict->old.index[i];
+	}
+
+	return NONE;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void *
+map(size_t n)
+{
+	const int prot  = PROT_READ | PROT_WRITE;
+	const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	char *ptr;
+	size_t skip;
+
+	n = HUGE_ALIGN(n);
+
+	/* huge pages reserved by the system are tried first. otherwise, a mapping one huge page larger gets */
+	/* trimmed down to an aligned one, so that the kernel can back it with transparent huge pages        */
+
+#if defined(MAP_HUGETLB)
+	if ((ptr = mmap(NULL, n, prot, flags | MAP_HUGETLB, -1, 0)) != MAP_FAILED)
+	{
+		return ptr;
+	}
+#endif
+
+	if ((ptr = mmap(NULL, n + HUGE_PAGE, prot, flags, -1, 0)) == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	skip = (HUGE_PAGE - (uintptr_t)ptr % HUGE_PAGE) % HUGE_PAGE;
+	if (skip > 0)
+	{
+		munmap(ptr, skip);
+	}
+	munmap(ptr + skip + n, HUGE_PAGE - skip);
+
+#if defined(MADV_HUGEPAGE)
+	madvise(ptr + skip, n, MADV_HUGEPAGE);
+#endif
+
+	return ptr + skip;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+migrate(cdict *dict, size_t n)
+{
+	size_t i;
+
+	if (dict->old.n_alloc == 0)
+	{
+		return true;
+	}
+
+	/* only entry indices move, erasing from a robin hood table can shift the next slot into the current one */
+	/* a cuckoo table that finds no room for an entry is grown in place, and if even that fails the entry is */
+	/* left in the old table, so that both tables still hold every key between them                          */
+
+	for (; n > 0 && dict->migrated < dict->old.n_alloc; n--, dict->migrated++)
+	{
+		for (i = dict->migrated; full(&dict->old, i); erase(dict, &dict->old, i))
+		{
+			if (!insert(dict, &dict->table, dict->old.index[i])
+			 && (!table_grow(dict, &dict->table) || !insert(dict, &dict->table, dict->old.index[i])))
+			{
+				dict->err = dict->err ? dict->err : CERR_OVERFLOW;
+				return false;
+			}
+		}
+	}
+
+	if (dict->migrated >= dict->old.n_alloc)
+	{
+		table_free(dict, &dict->old);
+	}
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static uint32_t
+pilot_search(const struct table *table, const uint64_t *hashes, size_t n, uint64_t *taken)
+{
+	size_t i;
+	size_t j;
+
+	/* slots are taken as they are found, so that keys of the bucket do not collide with each other either, */
+	/* and given back if one of them is already taken. direct pilots are never searched for, so they tell   */
+	/* when none could be found                                                                             */
+
+	for (uint32_t p = 0; p < PILOT_TRIES; p++)
+	{
+		for (j = 0; j < n; j++)
+		{
+			i = place(table, hashes[j], p);
+			if (taken[i / 64] & (uint64_t)1 << i % 64)
+			{
+				break;
+			}
+			taken[i / 64] |= (uint64_t)1 << i % 64;
+		}
+		if (j == n)
+		{
+			return p;
+		}
+		while (j-- > 0)
+		{
+			i = place(table, hashes[j], p);
+			taken[i / 64] &= ~((uint64_t)1 << i % 64);
+		}
+	}
+
+	return PILOT_DIRECT;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+place(const struct table *table, uint64_t hash, uint32_t pilot)
+{
+	uint64_t x;
+
+	/* pilots either hold the slot itself, or a salt that scatters the keys of their bucket over the table */
+
+	if (pilot & PILOT_DIRECT)
+	{
+		return pilot & ~PILOT_DIRECT;
+	}
+
+	x  = hash ^ pilot * CHAIN_MIX;
+	x ^= x >> 33;
+	x *= 0xFF51AFD7ED558CCD;
+	x ^= x >> 33;
+	x *= 0xC4CEB9FE1A85EC53;
+	x ^= x >> 33;
+
+	return (x >> 32) * table->n_alloc >> 32;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+probes(const cdict *dict, const struct table *table, const struct cdict_key *key)
+{
+	uint64_t hash = key->hash;
+	size_t i;
+	size_t n;
+
+	if ((i = find(dict, table, key)) != NONE)
+	{
+		switch (table->probing)
+		{
+			case CDICT_PROBE_GROUPS:
+				n = table->n_alloc / GROUP_WIDTH;
+				return (i / GROUP_WIDTH + n - hash % n) % n + 1;
+
+			case CDICT_PROBE_ROBIN_HOOD:
+				return distance(dict, table, i) + 1;
+
+			case CDICT_PROBE_PERFECT:
+				return 1;
+
+			case CDICT_PROBE_CUCKOO:
+				return cuckoo_probes(table, hash, i);
+		}
+	}
+
+	switch (table->probing)
+	{
+		case CDICT_PROBE_GROUPS:
+			n = table->n_alloc / GROUP_WIDTH;
+			i = hash % n;
+			for (size_t j = 1; j <= n; j++, i = (i + 1) % n)
+			{
+				if (group_match(table->ctrl + i * GROUP_WIDTH, CTRL_EMPTY))
+				{
+					return j;
+				}
+			}
+			return n;
+
+		case CDICT_PROBE_ROBIN_HOOD:
+			n = table->n_alloc;
+			i = hash % n;
+			for (size_t j = 0; j < n; j++, i = (i + 1) % n)
+			{
+				if (table->ctrl[i] == CTRL_EMPTY || distance(dict, table, i) < j)
+				{
+					return j + 1;
+				}
+			}
+			return n;
+
+		case CDICT_PROBE_PERFECT:
+			return 1;
+
+		case CDICT_PROBE_CUCKOO:
+			return 3;
+	}
+
+	return 0;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static struct range *
+range_create(struct store *store, size_t pages)
+{
+	struct range *range;
+	size_t n_alloc;
+	size_t n;
+
+	/* pages are never handed out twice, so those clones still map can't get overwritten. the file doubles */
+	/* whenever it runs out of pages, it is sparse so only the pages written to take memory                */
+
+	if (!safe_add(&n, store->n, pages) || n > SSIZE_MAX / store->page)
+	{
+		return NULL;
+	}
+
+	if (n > store->n_alloc)
+	{
+		n_alloc = store->n_alloc * 2 > n ? store->n_alloc * 2 : n;
+		n_alloc = n_alloc > SSIZE_MAX / store->page ? n : n_alloc;
+		if (ftruncate(store->fd, (off_t)(n_alloc * store->page)) < 0)
+		{
+			return NULL;
+		}
+		store->n_alloc = n_alloc;
+	}
+
+	if (!(range = malloc(sizeof(struct range) + pages * sizeof(unsigned))))
+	{
+		return NULL;
+	}
+
+	range->store  = store;
+	range->offset = store->n * store->page;
+	range->n      = pages;
+	range->n_used = pages;
+
+	for (size_t i = 0; i < pages; i++)
+	{
+		range->refs[i] = 1;
+	}
+
+	store->n = n;
+	store->refs++;
+
+	return range;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+range_drop(struct range *range, size_t first, size_t n)
+{
+	struct store *store = range->store;
+	size_t n_free       = 0;
+	size_t run          = 0;
+	size_t at;
+
+	/* runs of pages no span shows anymore are punched out of the file, which gives their memory back, */
+	/* except for pages a forked process may still map, see store_fork()                               */
+
+	for (size_t i = first; i <= first + n; i++)
+	{
+		if (i < first + n && --range->refs[i] == 0)
+		{
+			run++;
+			continue;
+		}
+		at = range->offset / store->page + i - run;
+		if (run > 0 && store->forks == store_forks && at + run > store->fence)
+		{
+			at = at > store->fence ? at : store->fence;
+			store_punch(store, at, range->offset / store->page + i - at);
+		}
+		n_free += run;
+		run     = 0;
+	}
+
+	if (n_free > 0 && (range->n_used -= n_free) == 0)
+	{
+		free(range);
+		store->refs--;
+		store_drop(store);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+range_take(struct range *range, size_t first, size_t n)
+{
+	for (size_t i = first; i < first + n; i++)
+	{
+		range->refs[i]++;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static const cdict *
+read_begin(const cdict *dict, atomic_size_t **n)
+{
+	struct readers *readers = dict->readers;
+	size_t epoch;
+
+	if (!readers)
+	{
+		*n = NULL;
+		return dict;
+	}
+
+	/* readers count themselves before loading the front, and the writer switches the front before waiting */
+	/* on the counts, so that with sequentially consistent accesses a reader it doesn't wait for is always */
+	/* given the new front. readers never wait themselves                                                  */
+
+	epoch = atomic_load(&readers->epoch);
+	*n    = &readers->slots[epoch][thread_slot()].n;
+
+	atomic_fetch_add(*n, 1);
+
+	return atomic_load(&readers->front);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+read_end(atomic_size_t *n)
+{
+	if (n)
+	{
+		atomic_fetch_sub_explicit(n, 1, memory_order_release);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+readers_bloom(struct readers *readers, const cbloom *bloom)
+{
+	cbloom *copy = NULL;
+
+	/* the filter gets written along with each copy, so the twin is given its own one */
+
+	if (bloom && (copy = cbloom_clone(bloom)) == CBLOOM_PLACEHOLDER)
+	{
+		return false;
+	}
+
+	if (readers->twin->bloom)
+	{
+		cbloom_destroy(readers->twin->bloom);
+	}
+
+	readers->twin->bloom = copy;
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+readers_init(cdict *dict)
+{
+	struct readers *readers;
+
+	if (!(readers = aligned_alloc(CACHE_LINE, sizeof(struct readers))))
+	{
+		return false;
+	}
+
+	if ((readers->twin = replicate(dict)) == CDICT_PLACEHOLDER)
+	{
+		free(readers);
+		return false;
+	}
+
+	atomic_init(&readers->front, dict);
+	atomic_init(&readers->epoch, 0);
+	for (size_t i = 0; i < READER_SLOTS; i++)
+	{
+		atomic_init(&readers->slots[0][i].n, 0);
+		atomic_init(&readers->slots[1][i].n, 0);
+	}
+
+	readers->replay = false;
+	readers->split  = false;
+
+	dict->readers = readers;
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+readers_switch(struct readers *readers, cdict *front)
+{
+	size_t epoch;
+
+	/* readers of the other epoch are waited for before it becomes the current one again, so that no reader */
+	/* of the previous front is left behind, then those of the current epoch are                            */
+
+	atomic_store(&readers->front, front);
+
+	epoch = atomic_load_explicit(&readers->epoch, memory_order_relaxed);
+
+	readers_wait(readers, !epoch);
+	atomic_store(&readers->epoch, !epoch);
+	readers_wait(readers, epoch);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+readers_sync(cdict *dict)
+{
+	struct readers *readers = dict->readers;
+	cdict *twin;
+
+	/* if the copy fails, the twin is flagged so that the next modification errors both */
+
+	if (atomic_load_explicit(&readers->front, memory_order_relaxed) != dict)
+	{
+		readers_switch(readers, dict);
+	}
+
+	if ((twin = replicate(dict)) == CDICT_PLACEHOLDER)
+	{
+		readers->twin->err = CERR_MEMORY;
+		return;
+	}
+
+	readers_bloom(readers, NULL);
+	cdict_destroy(readers->twin);
+
+	readers->twin  = twin;
+	readers->split = false;
+
+	if (!readers_bloom(readers, dict->bloom))
+	{
+		twin->err = CERR_MEMORY;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+readers_wait(struct readers *readers, size_t epoch)
+{
+	for (size_t i = 0; i < READER_SLOTS; i++)
+	{
+		while (atomic_load(&readers->slots[epoch][i].n) > 0)
+		{
+			sched_yield();
+		}
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void *
+region_clone(cdict *dict, struct region *src)
+{
+	struct region *region = NULL;
+	struct span *spans    = NULL;
+	struct store *store;
+	char *data            = MAP_FAILED;
+	size_t at             = 0;
+
+	pthread_mutex_lock(&store_lock);
+
+	if ((store = store_get())
+	 && region_settle(src, store)
+	 && (region = malloc(sizeof(struct region)))
+	 && (spans = malloc(src->n_spans * sizeof(struct span))))
+	{
+		data = mmap(NULL, src->n, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	}
+
+	/* the clone maps the same spans of the store, end to end in a reserved address range, and privately */
+	/* too, so that neither side sees the pages the other writes to                                      */
+
+	for (size_t i = 0; data != MAP_FAILED && i < src->n_spans; i++)
+	{
+		if (mmap(data + at, src->spans[i].n * store->page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+		         store->fd, src->spans[i].range->offset + src->spans[i].first * store->page) == MAP_FAILED)
+		{
+			munmap(data, src->n);
+			data = MAP_FAILED;
+		}
+		at += src->spans[i].n * store->page;
+	}
+
+	if (data == MAP_FAILED)
+	{
+		if (store)
+		{
+			store_drop(store);
+		}
+		pthread_mutex_unlock(&store_lock);
+		free(region);
+		free(spans);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < src->n_spans; i++)
+	{
+		range_take(src->spans[i].range, src->spans[i].first, src->spans[i].n);
+		spans[i] = src->spans[i];
+	}
+
+	pthread_mutex_unlock(&store_lock);
+
+	region->data    = data;
+	region->spans   = spans;
+	region->n_spans = src->n_spans;
+	region->n       = src->n;
+	region->next    = dict->regions;
+	dict->regions   = region;
+
+	return data;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static struct region *
+region_find(const cdict *dict, const void *ptr)
+{
+	for (struct region *region = dict->regions; region; region = region->next)
+	{
+		if (region->data == ptr)
+		{
+			return region;
+		}
+	}
+
+	return NULL;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+region_runs(bool *dirty, size_t n, size_t gap)
+{
+	size_t n_runs = 0;
+	size_t k;
+
+	/* clean pages between two runs, up to gap of them, join both runs */
+
+	for (size_t i = 0; i < n; i += k)
+	{
+		for (k = 1; i + k < n && dirty[i + k] == dirty[i]; k++);
+		if (!dirty[i] && k <= gap && i > 0 && i + k < n)
+		{
+			memset(dirty + i, true, k * sizeof(bool));
+		}
+		n_runs += dirty[i] && (i == 0 || !dirty[i - 1]);
+	}
+
+	return n_runs;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+region_scan(const struct region *region, size_t page, bool *dirty)
+{
+#if defined(__linux__)
+	uint64_t entries[512];
+	size_t n = region->n / page;
+	size_t k;
+	off_t at;
+	int fd;
+
+	/* the pages the kernel copied out of the store are anonymous, either present or swapped out. pages */
+	/* that are still those of the store are either file pages or not mapped yet                        */
+
+	if ((fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC)) < 0)
+	{
+		return false;
+	}
+
+	at = (uintptr_t)region->data / page * sizeof(uint64_t);
+
+	for (size_t i = 0; i < n; i += k)
+	{
+		k = n - i < 512 ? n - i : 512;
+		if (pread(fd, entries, k * sizeof(uint64_t), at + i * sizeof(uint64_t)) != (ssize_t)(k * sizeof(uint64_t)))
+		{
+			close(fd);
+			return false;
+		}
+		for (size_t j = 0; j < k; j++)
+		{
+			dirty[i + j] = (entries[j] >> 63 && !(entries[j] >> 61 & 1)) || entries[j] >> 62 & 1;
+		}
+	}
+
+	close(fd);
+
+	return true;
+#else
+	/* elsewhere, there is no telling which pages got copied, so regions get stored whole */
+
+	(void)region;
+	(void)page;
+	(void)dirty;
+	return false;
+#endif
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+region_settle(struct region *region, struct store *store)
+{
+	const int prot      = PROT_READ | PROT_WRITE;
+	struct range *range = NULL;
+	struct span *pages;
+	struct span *spans;
+	bool *dirty;
+	size_t n       = region->n / store->page;
+	size_t n_spans = 0;
+	size_t n_runs;
+	size_t budget;
+	size_t k;
+	bool ok = true;
+
+	/* the runs of pages written to since the region was last cloned get stored in fresh ranges, and mapped */
+	/* back in place. their content stays the same, so readers of the dictionary don't notice the mappings  */
+	/* change under them. too many runs would split the region in as many mappings, so the shortest gaps    */
+	/* between runs get stored along, or the whole region once it is split enough already. regions that     */
+	/* were never cloned, or whose pages are in a store a fork retired, are stored whole                    */
+
+	dirty = malloc(n * sizeof(bool));
+	pages = malloc(n * sizeof(struct span));
+
+	if (!dirty || !pages)
+	{
+		free(dirty);
+		free(pages);
+		return false;
+	}
+
+	if (region->n_spans == 0
+	 || region->spans[0].range->store != store
+	 || !region_scan(region, store->page, dirty))
+	{
+		memset(dirty, true, n * sizeof(bool));
+	}
+
+	n_runs = region_runs(dirty, n, 0);
+	budget = region->n_spans < SPANS_MAX / 2 ? (SPANS_MAX - region->n_spans) / 2 : 0;
+
+	for (size_t gap = 1; n_runs > budget && budget > 0; gap *= 2)
+	{
+		n_runs = region_runs(dirty, n, gap);
+	}
+
+	if (n_runs > budget)
+	{
+		memset(dirty, true, n * sizeof(bool));
+		n_runs = 1;
+	}
+
+	if (n_runs == 0 || !(spans = malloc((region->n_spans + 2 * n_runs) * sizeof(struct span))))
+	{
+		free(dirty);
+		free(pages);
+		return n_runs == 0;
+	}
+
+	for (size_t i = 0; region->n_spans == 0 && i < n; i++)
+	{
+		pages[i] = (struct span){NULL, 0, 1};
+	}
+
+	for (size_t s = 0, i = 0; s < region->n_spans; s++)
+	{
+		for (size_t j = 0; j < region->spans[s].n; j++)
+		{
+			pages[i++] = (struct span){region->spans[s].range, region->spans[s].first + j, 1};
+		}
+	}
+
+	for (size_t i = 0; ok && i < n; i += k)
+	{
+		for (k = 0; i + k < n && dirty[i + k]; k++);
+		if (k == 0)
+		{
+			k = 1;
+			continue;
+		}
+		ok = (range = range_create(store, k))
+		  && store_write(store, range->offset, region->data + i * store->page, k * store->page)
+		  && mmap(region->data + i * store->page, k * store->page, prot, MAP_PRIVATE | MAP_FIXED, store->fd,
+		          range->offset) != MAP_FAILED;
+		if (!ok && range)
+		{
+			range_drop(range, 0, k);
+		}
+		for (size_t j = 0, m = 1; ok && j < k; j += m)
+		{
+			/* pages of the same range are dropped together, so that they get punched out at once */
+
+			for (m = 1; j + m < k
+			         && pages[i + j + m].range == pages[i + j].range
+			         && pages[i + j + m].first == pages[i + j].first + m; m++);
+			if (pages[i + j].range)
+			{
+				range_drop(pages[i + j].range, pages[i + j].first, m);
+			}
+		}
+		for (size_t j = 0; ok && j < k; j++)
+		{
+			pages[i + j] = (struct span){range, j, 1};
+		}
+	}
+
+	/* a region stored whole is left as is if that fails. otherwise, pages are merged back into spans, a */
+	/* run splits at most one span in two                                                                */
+
+	for (size_t i = 0; (ok || region->n_spans > 0) && i < n; i++)
+	{
+		if (n_spans > 0
+		 && spans[n_spans - 1].range == pages[i].range
+		 && spans[n_spans - 1].first + spans[n_spans - 1].n == pages[i].first)
+		{
+			spans[n_spans - 1].n++;
+		}
+		else
+		{
+			spans[n_spans++] = pages[i];
+		}
+	}
+
+	if (n_spans > 0)
+	{
+		free(region->spans);
+		region->spans   = spans;
+		region->n_spans = n_spans;
+	}
+	else
+	{
+		free(spans);
+	}
+
+	free(dirty);
+	free(pages);
+
+	return ok;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+rehash(cdict *dict, size_t n, enum cdict_probing probing)
+{
+	struct table table;
+
+	if (!migrate(dict, SIZE_MAX))
+	{
+		return false;
+	}
+
+	if (!safe_add(&n, n, GROUP_WIDTH - 1 - (n - 1) % GROUP_WIDTH)
+	 || !safe_mul(NULL, n, sizeof(uint32_t)))
+	{
+		dict->err = CERR_OVERFLOW;
+		return false;
+	}
+
+	if (!table_init(dict, &table, n))
+	{
+		dict->err = CERR_MEMORY;
+		return false;
+	}
+
+	/* the old table is kept around until all of its slots got moved, in one go or a few at each write */
+
+	table.probing  = probing;
+	dict->old      = dict->table;
+	dict->table    = table;
+	dict->migrated = 0;
+
+	migrate(dict, dict->step > 0 ? dict->step : SIZE_MAX);
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+rehash_perfect(cdict *dict)
+{
+	struct table table = {0};
+	uint64_t *hashes;
+	uint64_t *taken;
+	uint32_t *keys;
+	uint32_t *start = NULL;
+	size_t n_max;
+	size_t n;
+	size_t b;
+	size_t c;
+	size_t k;
+	bool ok = false;
+
+	if (!migrate(dict, SIZE_MAX))
+	{
+		return false;
+	}
+
+	if (dict->table.n > PILOT_DIRECT)
+	{
+		dict->err = CERR_OVERFLOW;
+		return false;
+	}
+
+	table.n       = dict->table.n;
+	table.n_alloc = table.n > 0 ? table.n : 1;
+	table.probing = CDICT_PROBE_PERFECT;
+	table.index   = acquire(dict, table.n_alloc * sizeof(uint32_t));
+	taken         = malloc((table.n_alloc + 63) / 64 * sizeof(uint64_t));
+	hashes        = malloc((table.n + 1) * sizeof(uint64_t));
+	keys          = malloc((table.n + 1) * sizeof(uint32_t));
+
+	/* keys are sorted by bucket, then the biggest buckets get a pilot first, while the table is still     */
+	/* mostly free. single key buckets come last and simply take one of the remaining slots. if a bucket   */
+	/* runs out of pilots to try, which is unlikely, everything is started over with smaller buckets. the  */
+	/* search only reads the sorted hashes and a bitmap of taken slots, which are far more cache friendly  */
+	/* than the entries and slots themselves                                                               */
+
+	for (size_t n_pilots = table.n / PILOT_LOAD + 1; !ok && n_pilots <= table.n_alloc * 2; n_pilots *= 2)
+	{
+		release(dict, table.pilots);
+		free(start);
+
+		table.pilots   = acquire(dict, n_pilots * sizeof(uint32_t));
+		table.n_pilots = n_pilots;
+		start          = calloc(n_pilots + 1, sizeof(uint32_t));
+		n_max          = 0;
+
+		if (!table.index || !taken || !hashes || !keys || !table.pilots || !start)
+		{
+			dict->err = CERR_MEMORY;
+			break;
+		}
+
+		memset(table.index, 0xFF, table.n_alloc * sizeof(uint32_t));
+		memset(taken, 0, (table.n_alloc + 63) / 64 * sizeof(uint64_t));
+
+		for (size_t e = entry_next(dict, 0); e != NONE; e = entry_next(dict, e + 1))
+		{
+			start[bucket(&table, dict->hashes[e])]++;
+		}
+
+		for (b = 1; b <= n_pilots; b++)
+		{
+			start[b] += start[b - 1];
+		}
+
+		for (size_t e = entry_next(dict, 0); e != NONE; e = entry_next(dict, e + 1))
+		{
+			k         = --start[bucket(&table, dict->hashes[e])];
+			keys[k]   = e;
+			hashes[k] = dict->hashes[e];
+		}
+
+		for (b = 0; b < n_pilots; b++)
+		{
+			n_max = start[b + 1] - start[b] > n_max ? start[b + 1] - start[b] : n_max;
+		}
+
+		ok = true;
+
+		for (n = n_max; ok && n > 1; n--)
+		{
+			for (b = 0; ok && b < n_pilots; b++)
+			{
+				if (start[b + 1] - start[b] != n)
+				{
+					continue;
+				}
+				table.pilots[b] = pilot_search(&table, hashes + start[b], n, taken);
+				ok              = table.pilots[b] != PILOT_DIRECT;
+				for (k = start[b]; ok && k < start[b + 1]; k++)
+				{
+					table.index[place(&table, hashes[k], table.pilots[b])] = keys[k];
+				}
+			}
+		}
+
+		for (b = 0, c = 0; ok && b < n_pilots; b++)
+		{
+			if (start[b + 1] - start[b] == 1)
+			{
+				for (; taken[c / 64] & (uint64_t)1 << c % 64; c++);
+				taken[c / 64]  |= (uint64_t)1 << c % 64;
+				table.index[c]  = keys[start[b]];
+				table.pilots[b] = PILOT_DIRECT | c;
+			}
+		}
+	}
+
+	/* buckets can only run out of pilots for good if they hold keys that share the same hash */
+
+	if (ok)
+	{
+		table_free(dict, &dict->table);
+		dict->table = table;
+	}
+	else
+	{
+		table_free(dict, &table);
+		dict->err = dict->err ? dict->err : CERR_PARAM;
+	}
+
+	free(taken);
+	free(hashes);
+	free(keys);
+	free(start);
+
+	return ok;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+release(cdict *dict, void *ptr)
+{
+	struct region **link;
+	struct region *region;
+
+	for (link = &dict->regions; *link && (*link)->data != ptr; link = &(*link)->next);
+
+	if (!ptr || !(region = *link))
+	{
+		free(ptr);
+		return;
+	}
+
+	*link = region->next;
+
+	munmap(region->data, region->n);
+
+	if (region->n_spans > 0)
+	{
+		pthread_mutex_lock(&store_lock);
+		for (size_t i = 0; i < region->n_spans; i++)
+		{
+			range_drop(region->spans[i].range, region->spans[i].first, region->spans[i].n);
+		}
+		pthread_mutex_unlock(&store_lock);
+	}
+
+	free(region->spans);
+	free(region);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static cdict *
+replicate(const cdict *dict)
+{
+	cdict *dict_new;
+	bool ok;
+
+	if (!(dict_new = calloc(1, sizeof(cdict))))
+	{
+		return CDICT_PLACEHOLDER;
+	}
+
+	/* big arrays are mapped from the pages the source stores them in, see region_clone() */
+
+	*dict_new         = *dict;
+	dict_new->readers = NULL;
+	dict_new->sampler = NULL;
+	dict_new->regions = NULL;
+	dict_new->bloom   = NULL;
+	dict_new->image   = NULL;
+	dict_new->n_image = 0;
+
+	ok = table_copy(dict_new, dict, &dict_new->table, &dict->table);
+	ok = table_copy(dict_new, dict, &dict_new->old,   &dict->old) && ok;
+	ok = (!dict->sampler || sampler_init(dict_new, dict->sampler->period)) && ok;
+
+	dict_new->hashes = copy(dict_new, dict, dict->hashes, dict->n_entries_alloc * sizeof(uint64_t));
+	dict_new->values = copy(dict_new, dict, dict->values, dict->n_entries_alloc * VALUE_WIDTH(dict));
+	dict_new->groups = copy(dict_new, dict, dict->groups, dict->n_entries_alloc * WIDTH(dict));
+	dict_new->live   = copy(dict_new, dict, dict->live,   (dict->n_entries_alloc + 63) / 64 * sizeof(uint64_t));
+	dict_new->keys   = copy(dict_new, dict, dict->keys,   dict->n_entries_alloc * sizeof(struct key));
+	dict_new->links  = copy(dict_new, dict, dict->links,  dict->n_entries_alloc * sizeof(struct link));
+	dict_new->chains = copy(dict_new, dict, dict->chains, dict->n_chains_alloc * sizeof(struct chain));
+	dict_new->chars  = copy(dict_new, dict, dict->chars,  dict->n_chars_alloc);
+
+	if (!ok
+	 || (dict->hashes  && !dict_new->hashes)
+	 || (dict->values  && !dict_new->values)
+	 || (dict->groups  && !dict_new->groups)
+	 || (dict->live    && !dict_new->live)
+	 || (dict->keys    && !dict_new->keys)
+	 || (dict->links   && !dict_new->links)
+	 || (dict->chains  && !dict_new->chains)
+	 || (dict->chars   && !dict_new->chars))
+	{
+		cdict_destroy(dict_new);
+		return CDICT_PLACEHOLDER;
+	}
+
+	return dict_new;
+}
+
+static void *
+resize(cdict *dict, void *ptr, size_t n_old, size_t n, size_t size)
+{
+	void *tmp;
+
+	if (n * size < SHARE_MIN && !region_find(dict, ptr))
+	{
+		return realloc(ptr, n * size);
+	}
+
+	/* regions can't be resized in place, other arrays move to one once big enough */
+
+	if (!(tmp = acquire(dict, n * size)))
+	{
+		return NULL;
+	}
+
+	if (ptr)
+	{
+		memcpy(tmp, ptr, (n < n_old ? n : n_old) * size);
+	}
+
+	release(dict, ptr);
+
+	return tmp;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+sample(const cdict *dict, bool found)
+{
+	atomic_size_t *tick;
+
+	if (!dict->sampler)
+	{
+		return;
+	}
+
+	/* threads sharing a slot share its ticks too, which keeps exactly one sampled lookup per period */
+
+	tick = &dict->sampler->ticks[thread_slot()].n;
+
+	if ((atomic_fetch_add_explicit(tick, 1, memory_order_relaxed) + 1) % dict->sampler->period != 0)
+	{
+		return;
+	}
+
+	atomic_fetch_add_explicit(found ? &dict->sampler->hits : &dict->sampler->misses, 1, memory_order_relaxed);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+sampler_init(cdict *dict, size_t period)
+{
+	if (!(dict->sampler = aligned_alloc(CACHE_LINE, sizeof(struct sampler))))
+	{
+		return false;
+	}
+
+	atomic_init(&dict->sampler->hits,   0);
+	atomic_init(&dict->sampler->misses, 0);
+
+	for (size_t i = 0; i < READER_SLOTS; i++)
+	{
+		atomic_init(&dict->sampler->ticks[i].n, 0);
+	}
+
+	dict->sampler->period = period;
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+sections(const cdict *dict, struct section *at)
+{
+	size_t n_words = (dict->n_entries_alloc + 63) / 64;
+
+	/* every array with its allocated size */
+
+	at[0]  = (struct section){dict->table.ctrl,   dict->table.ctrl ? dict->table.n_alloc : 0};
+	at[1]  = (struct section){dict->table.pilots, dict->table.n_pilots * sizeof(uint32_t)};
+	at[2]  = (struct section){dict->table.index,  dict->table.n_alloc * sizeof(uint32_t)};
+	at[3]  = (struct section){dict->old.ctrl,     dict->old.ctrl ? dict->old.n_alloc : 0};
+	at[4]  = (struct section){dict->old.pilots,   dict->old.n_pilots * sizeof(uint32_t)};
+	at[5]  = (struct section){dict->old.index,    dict->old.n_alloc * sizeof(uint32_t)};
+	at[6]  = (struct section){dict->hashes,       dict->n_entries_alloc * sizeof(uint64_t)};
+	at[7]  = (struct section){dict->values,       dict->n_entries_alloc * VALUE_WIDTH(dict)};
+	at[8]  = (struct section){dict->groups,       dict->n_entries_alloc * WIDTH(dict)};
+	at[9]  = (struct section){dict->live,         n_words * sizeof(uint64_t)};
+	at[10] = (struct section){dict->keys,         dict->keys  ? dict->n_entries_alloc * sizeof(struct key)  : 0};
+	at[11] = (struct section){dict->links,        dict->links ? dict->n_entries_alloc * sizeof(struct link) : 0};
+	at[12] = (struct section){dict->chains,       dict->n_chains_alloc * sizeof(struct chain)};
+	at[13] = (struct section){dict->chars,        dict->n_chars_alloc};
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+shrink(cdict *dict, size_t n, size_t n_entries)
+{
+	struct table table;
+	void *tmp;
+	size_t n_chars;
+	size_t n_old;
+
+	if (!migrate(dict, SIZE_MAX))
+	{
+		return;
+	}
+
+	/* the table is cut down where it stands then rebuilt from the entries by the compaction, so no second  */
+	/* table gets allocated. a failed shrinking realloc leaves the bigger block in place, which is harmless */
+	/* mapped tables can't be cut down in place, so they get swapped for a smaller one if it can be made    */
+
+	n = n > GROUP_WIDTH ? n : GROUP_WIDTH;
+
+	if (dict->table.probing != CDICT_PROBE_PERFECT && n < dict->table.n_alloc && dict->table.mapped)
+	{
+		n += GROUP_WIDTH - 1 - (n - 1) % GROUP_WIDTH;
+		if (table_init(dict, &table, n))
+		{
+			table.probing = dict->table.probing;
+			table_free(dict, &dict->table);
+			dict->table = table;
+		}
+	}
+	else if (dict->table.probing != CDICT_PROBE_PERFECT && n < dict->table.n_alloc)
+	{
+		n    += GROUP_WIDTH - 1 - (n - 1) % GROUP_WIDTH;
+		n_old = dict->table.n_alloc;
+		if ((tmp = resize(dict, dict->table.ctrl, n_old, n, 1)))
+		{
+			dict->table.ctrl = tmp;
+		}
+		if ((tmp = resize(dict, dict->table.index, n_old, n, sizeof(uint32_t))))
+		{
+			dict->table.index = tmp;
+		}
+		dict->table.n_alloc = n;
+	}
+
+	compact(dict);
+
+	/* entry arrays keep room for n_entries, and the key arena for as many keys of the current mean length */
+
+	n_chars   = dict->n_entries > 0 ? (double)dict->n_chars / dict->n_entries * n_entries : 0;
+	n_chars   = n_chars > dict->n_chars ? n_chars : dict->n_chars;
+	n_chars   = n_chars > 64 ? n_chars : 64;
+	n_entries = n_entries > dict->n_entries ? n_entries : dict->n_entries;
+	n_entries = n_entries > GROUP_WIDTH ? n_entries : GROUP_WIDTH;
+
+	if (n_entries < dict->n_entries_alloc)
+	{
+		n_old = dict->n_entries_alloc;
+		if ((tmp = resize(dict, dict->hashes, n_old, n_entries, sizeof(uint64_t))))
+		{
+			dict->hashes = tmp;
+		}
+		if ((tmp = resize(dict, dict->values, n_old, n_entries, VALUE_WIDTH(dict))))
+		{
+			dict->values = tmp;
+		}
+		if ((tmp = resize(dict, dict->groups, n_old, n_entries, WIDTH(dict))))
+		{
+			dict->groups = tmp;
+		}
+		if ((tmp = resize(dict, dict->live, (n_old + 63) / 64, (n_entries + 63) / 64, sizeof(uint64_t))))
+		{
+			dict->live = tmp;
+		}
+		if (dict->keys && (tmp = resize(dict, dict->keys, n_old, n_entries, sizeof(struct key))))
+		{
+			dict->keys = tmp;
+		}
+		if (dict->links && (tmp = resize(dict, dict->links, n_old, n_entries, sizeof(struct link))))
+		{
+			dict->links = tmp;
+		}
+		dict->n_entries_alloc = n_entries;
+	}
 
-#include "safe.h"
+	if (dict->chars && n_chars < dict->n_chars_alloc
+	 && (tmp = resize(dict, dict->chars, dict->n_chars_alloc, n_chars, 1)))
+	{
+		dict->chars         = tmp;
+		dict->n_chars_alloc = n_chars;
+	}
 
-/************************************************************************************************************/
-/************************************************************************************************************/
-/************************************************************************************************************/
+	/* chains only need to stay under half full */
 
-#define HASH_OFFSET 14695981039346656037ULL
-#define HASH_PRIME  1099511628211ULL
+	if (dict->chains && dict->n_chains * 4 < dict->n_chains_alloc / 2)
+	{
+		chain_rehash(dict, dict->n_chains * 4 > GROUP_WIDTH ? dict->n_chains * 4 : GROUP_WIDTH);
+	}
+}
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-enum state
+static void
+stats_add(const cdict *dict, struct cdict_stats *stats)
 {
-	UNUSED  = 0,
-	DELETED = 1,
-	ACTIVE  = 2,
-};
+	struct section at[SECTIONS];
 
-/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+	if (dict->image)
+	{
+		stats->bytes += dict->n_image;
+	}
+	else
+	{
+		sections(dict, at);
+		for (size_t i = 0; i < SECTIONS; i++)
+		{
+			stats->bytes += at[i].n;
+		}
+	}
 
-struct slot
-{
-	uint64_t hash;
-	size_t value;
-	size_t group;
-	enum state state;
-};
+	stats->bytes += sizeof(cdict);
+
+	if (dict->sampler)
+	{
+		stats->bytes  += sizeof(struct sampler);
+		stats->hits   += atomic_load(&dict->sampler->hits)   * dict->sampler->period;
+		stats->misses += atomic_load(&dict->sampler->misses) * dict->sampler->period;
+	}
+}
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-struct cdict
+static struct store *
+store_create(void)
 {
-	struct slot *slots;
-	size_t n;
-	size_t n_alloc;
-	double max_load;
-	enum cerr err;
-};
-
-/************************************************************************************************************/
-/************************************************************************************************************/
-/************************************************************************************************************/
+	struct store *store;
+	char name[64];
+	int fd = -1;
 
-static struct slot *find     (const cdict *, uint64_t, enum state) CDICT_NONNULL(1) CDICT_PURE;
-static uint64_t     get_hash (const char *, size_t)                CDICT_NONNULL(1) CDICT_PURE;
-static bool         grow     (cdict *, size_t)                     CDICT_NONNULL(1);
+	/* names of files that crashed processes left behind are skipped, the file is unlinked as soon as it */
+	/* is open                                                                                           */
 
-/************************************************************************************************************/
-/************************************************************************************************************/
-/************************************************************************************************************/
+	for (size_t i = 0; fd < 0 && i < STORE_TRIES; i++)
+	{
+		snprintf(name, sizeof(name), "/cdict.%ld.%zu", (long)getpid(), i);
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+	}
 
-cdict cdict_placeholder_instance = 
-{
-	.slots    = NULL,
-	.n        = 0,
-	.n_alloc  = 0,
-	.max_load = 1.0,
-	.err      = CERR_INVALID,
-};
+	if (fd < 0)
+	{
+		return NULL;
+	}
 
-/************************************************************************************************************/
-/* PUBLIC ***************************************************************************************************/
-/************************************************************************************************************/
+	shm_unlink(name);
 
-void
-cdict_clear(cdict *dict)
-{
-	if (dict->err)
+	if (!(store = malloc(sizeof(struct store))))
 	{
-		return;
+		close(fd);
+		return NULL;
 	}
 
-	memset(dict->slots, 0, dict->n_alloc * sizeof(struct slot));
-	dict->n = 0;
+	store->refs    = 0;
+	store->n       = 0;
+	store->n_alloc = 0;
+	store->fence   = 0;
+	store->forks   = store_forks;
+	store->page    = sysconf(_SC_PAGESIZE);
+	store->fd      = fd;
+
+	return store;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-void
-cdict_clear_group(cdict *dict, size_t group)
+static void
+store_drop(struct store *store)
 {
-	if (dict->err)
+	if (store->refs > 0)
 	{
 		return;
 	}
 
-	for (size_t i = 0; i < dict->n_alloc; i++)
+	if (store_last == store)
 	{
-		if (dict->slots[i].state == ACTIVE && dict->slots[i].group == group)
-		{
-			dict->slots[i].state = DELETED;
-			dict->n--;
-		}
+		store_last = NULL;
 	}
+
+	close(store->fd);
+	free(store);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-cdict *
-cdict_clone(const cdict *dict)
+static void
+store_fork(void)
 {
-	cdict *dict_new;
+	/* pages handed out so far may get mapped by the child, so the parent no longer punches them */
 
-	if (dict->err || !(dict_new = malloc(sizeof(cdict))))
-	{
-		return CDICT_PLACEHOLDER;
-	}
+	pthread_mutex_lock(&store_lock);
 
-	if (!(dict_new->slots = malloc(dict->n_alloc * sizeof(struct slot))))
+	if (store_last)
 	{
-		free(dict_new);
-		return CDICT_PLACEHOLDER;
+		store_last->fence = store_last->n;
 	}
+}
 
-	memcpy(dict_new->slots, dict->slots, dict->n_alloc * sizeof(struct slot));
-
-	dict_new->n        = dict->n;
-	dict_new->n_alloc  = dict->n_alloc;
-	dict_new->max_load = dict->max_load;
-	dict_new->err      = CERR_NONE;
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-	return dict_new;
+static void
+store_forked(void)
+{
+	pthread_mutex_unlock(&store_lock);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-cdict *
-cdict_create(void)
+static struct store *
+store_get(void)
 {
-	cdict *dict;
+	/* stores are only used once the fork handlers are in place, otherwise arrays are deep copied */
+
+	pthread_once(&store_once, store_setup);
 
-	if (!(dict = malloc(sizeof(cdict))))
+	if (store_ready && !store_last)
 	{
-		return CDICT_PLACEHOLDER;
+		store_last = store_create();
 	}
 
-	if (!(dict->slots = calloc(1, sizeof(struct slot))))
+	return store_ready ? store_last : NULL;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+store_punch(struct store *store, size_t first, size_t n)
+{
+#if defined(MADV_REMOVE)
+	const off_t offset = first * store->page;
+	const size_t size  = n * store->page;
+	char *data;
+
+	/* pages only leave the file through a shared mapping of it, which lives for the time of the call */
+
+	if ((data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, store->fd, offset)) != MAP_FAILED)
 	{
-		free(dict);
-		return CDICT_PLACEHOLDER;
+		madvise(data, size, MADV_REMOVE);
+		munmap(data, size);
 	}
+#else
+	(void)store;
+	(void)first;
+	(void)n;
+#endif
+}
 
-	dict->n        = 0;
-	dict->n_alloc  = 1;
-	dict->max_load = 0.6;
-	dict->err      = CERR_NONE;
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-	return dict;
+static void
+store_retire(void)
+{
+	/* the child leaves the stores it inherits to the parent, it neither punches nor extends them */
+
+	store_forks++;
+	store_last = NULL;
+
+	pthread_mutex_unlock(&store_lock);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-void
-cdict_destroy(cdict *dict)
+static void
+store_setup(void)
 {
-	if (dict == CDICT_PLACEHOLDER)
+	store_ready = pthread_atfork(store_fork, store_forked, store_retire) == 0;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static bool
+store_write(struct store *store, size_t offset, const char *data, size_t n)
+{
+	ssize_t k;
+
+	for (size_t i = 0; i < n; i += k)
 	{
-		return;
+		if ((k = pwrite(store->fd, data + i, n - i, offset + i)) <= 0)
+		{
+			return false;
+		}
 	}
 
-	free(dict->slots);
-	free(dict);
+	return true;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-void
-cdict_erase(cdict *dict, const char *key, size_t group)
+static bool
+table_copy(cdict *dict, const cdict *src, struct table *table, const struct table *from)
 {
-	struct slot *slot;
+	const size_t n_index = from->n_alloc * sizeof(uint32_t);
 
-	if (dict->err)
+	/* tables on huge pages would be split into small ones by the store, so they are always copied */
+
+	*table = *from;
+
+	table->ctrl   = from->mapped ? map(from->n_alloc) : copy(dict, src, from->ctrl, from->n_alloc);
+	table->pilots = copy(dict, src, from->pilots, from->n_pilots * sizeof(uint32_t));
+	table->index  = from->mapped ? map(n_index) : copy(dict, src, from->index, n_index);
+
+	if ((from->ctrl && !table->ctrl) || (from->pilots && !table->pilots) || (from->index && !table->index))
 	{
-		return;
+		table_free(dict, table);
+		return false;
 	}
 
-	if ((slot = find(dict, get_hash(key, group), UNUSED)) && slot->state == ACTIVE)
+	if (from->mapped)
 	{
-		slot->state = DELETED;
-		dict->n--;
+		memcpy(table->ctrl,  from->ctrl,  from->n_alloc);
+		memcpy(table->index, from->index, n_index);
 	}
+
+	return true;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-enum cerr
-cdict_error(const cdict *dict)
+static void
+table_free(cdict *dict, struct table *table)
 {
-	return dict->err;
+	if (table->mapped)
+	{
+		unmap(table->ctrl,  table->n_alloc);
+		unmap(table->index, table->n_alloc * sizeof(uint32_t));
+	}
+	else
+	{
+		release(dict, table->ctrl);
+		release(dict, table->index);
+	}
+
+	release(dict, table->pilots);
+
+	table->ctrl      = NULL;
+	table->pilots    = NULL;
+	table->index     = NULL;
+	table->n         = 0;
+	table->n_deleted = 0;
+	table->n_alloc   = 0;
+	table->n_pilots  = 0;
+	table->mapped    = false;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-bool
-cdict_find(const cdict *dict, const char *key, size_t group, size_t *value)
+static bool
+table_grow(cdict *dict, struct table *table)
 {
-	struct slot *slot;
+	struct table bigger;
+
+	if (!safe_mul(NULL, table->n_alloc, 2 * sizeof(uint32_t)))
+	{
+		dict->err = CERR_OVERFLOW;
+		return false;
+	}
 
-	if (dict->err || !(slot = find(dict, get_hash(key, group), UNUSED)) || slot->state != ACTIVE)
+	if (!table_init(dict, &bigger, table->n_alloc * 2))
 	{
+		dict->err = CERR_MEMORY;
 		return false;
 	}
 
-	if (value)
+	bigger.probing = table->probing;
+
+	for (size_t i = 0; i < table->n_alloc; i++)
 	{
-		*value = slot->value;
+		if (full(table, i) && !insert(dict, &bigger, table->index[i]))
+		{
+			table_free(dict, &bigger);
+			dict->err = CERR_OVERFLOW;
+			return false;
+		}
 	}
 
+	table_free(dict, table);
+	*table = bigger;
+
 	return true;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-size_t
-cdict_load(const cdict *dict)
+static bool
+table_init(cdict *dict, struct table *table, size_t n)
 {
-	if (dict->err)
+	/* fresh mappings come zeroed, which saves touching the control bytes of big tables before their use */
+
+	table->mapped    = dict->flags & CDICT_HUGE_PAGES && n >= HUGE_PAGE / sizeof(uint32_t);
+	table->ctrl      = table->mapped ? map(n) : acquire(dict, n);
+	table->pilots    = NULL;
+	table->index     = table->mapped ? map(n * sizeof(uint32_t)) : acquire(dict, n * sizeof(uint32_t));
+	table->n         = 0;
+	table->n_deleted = 0;
+	table->n_alloc   = n;
+	table->n_pilots  = 0;
+
+	if (!table->ctrl || !table->index)
 	{
-		return 0;
+		table_free(dict, table);
+		return false;
 	}
 
-	return dict->n;
+	return true;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-double
-cdict_load_factor(const cdict *dict)
+static size_t
+thread_slot(void)
 {
-	if (dict->err)
+	if (reader_slot == NONE)
 	{
-		return 0.0;
+		reader_slot = atomic_fetch_add_explicit(&reader_next, 1, memory_order_relaxed) % READER_SLOTS;
 	}
 
-	return (double)dict->n / dict->n_alloc;
+	return reader_slot;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-void
-cdict_prealloc(cdict *dict, size_t slots_number)
+static void
+tidy(cdict *dict)
 {
-	if (dict->err)
+	size_t n;
+
+	/* once the load falls under a fraction of the maximum, the table shrinks back to a load halfway below */
+	/* it, far enough from both thresholds that a few writes or erasures don't resize it again. tombstones */
+	/* are swept in place when they pile up. both wait for an ongoing resize to end, and when resizes must */
+	/* stay incremental they go through a new table instead. perfect tables have neither                   */
+
+	if (dict->old.n_alloc > 0 || dict->table.probing == CDICT_PROBE_PERFECT)
 	{
 		return;
 	}
 
-	if (slots_number > SIZE_MAX * dict->max_load)
+	n = dict->table.n / (dict->max_load * SHRINK_TARGET);
+	n = n > dict->reserved ? n : dict->reserved;
+	n = n > GROUP_WIDTH ? n : GROUP_WIDTH;
+
+	if (dict->table.n_alloc > GROUP_WIDTH
+	 && dict->table.n < dict->table.n_alloc * dict->max_load * SHRINK_FLOOR
+	 && n <= dict->table.n_alloc / 2)
 	{
-		dict->err = CERR_OVERFLOW;
-		return;
+		if (dict->step > 0)
+		{
+			rehash(dict, n, dict->table.probing);
+		}
+		else
+		{
+			shrink(dict, n, n * dict->max_load);
+		}
+	}
+	else if (dict->table.n_deleted > dict->table.n_alloc * dict->max_load * SWEEP_FLOOR)
+	{
+		if (dict->step > 0)
+		{
+			rehash(dict, dict->table.n_alloc, dict->table.probing);
+		}
+		else
+		{
+			compact(dict);
+		}
 	}
-
-	grow(dict, slots_number / dict->max_load);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-void
-cdict_repair(cdict *dict)
+static void
+unmap(void *ptr, size_t n)
 {
-	if (dict->err != CERR_INVALID)
+	if (ptr)
 	{
-		dict->err = CERR_NONE;
+		munmap(ptr, HUGE_ALIGN(n));
 	}
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-void
-cdict_set_max_load(cdict *dict, double load_factor)
+static void
+update(cdict *dict, const struct cdict_key *key, size_t value, const void *ref)
 {
-	if (dict->err)
+	size_t e;
+	size_t n;
+
+	if (dict->flags & CDICT_COMPACT_VALUES && (value > UINT32_MAX || key->group > UINT32_MAX))
 	{
+		dict->err = CERR_OVERFLOW;
 		return;
 	}
 
-	if (load_factor <= 0.0 || load_factor > 1.0)
+	if (!migrate(dict, dict->step))
 	{
-		dict->err = CERR_PARAM;
 		return;
 	}
 
-	if (dict->n > SIZE_MAX * load_factor)
+	if ((e = lookup(dict, key)) != NONE)
 	{
-		dict->err = CERR_OVERFLOW;
+		value_set(dict, e, value, ref);
 		return;
 	}
 
-	if (grow(dict, dict->n / load_factor))
+	if (dict->keys && key->length > UINT32_MAX)
 	{
-		dict->max_load = load_factor;
+		dict->err = CERR_OVERFLOW;
+		return;
 	}
-}
 
-/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+	n = dict->table.n + dict->old.n;
 
-void
-cdict_write(cdict *dict, const char *key, size_t group, size_t value)
-{
-	struct slot *slot;
-	struct slot *slot_2;
-	uint64_t hash;
+	/* new keys take the dictionary out of perfect probing */
 
-	if (dict->err)
+	if (dict->table.probing == CDICT_PROBE_PERFECT
+	 && !rehash(dict, (n + 1) / dict->max_load, CDICT_PROBE_GROUPS))
 	{
 		return;
 	}
 
-	if (dict->n >= dict->n_alloc * dict->max_load)
+	if (n + dict->table.n_deleted >= dict->table.n_alloc * dict->max_load)
 	{
-		if (!safe_mul(NULL, dict->n_alloc, 2))
+		if (n < dict->table.n_alloc * dict->max_load / 2)
+		{
+			/* mostly tombstones, they get swept in place unless resizes must stay incremental */
+			if (dict->step == 0)
+			{
+				if (!migrate(dict, SIZE_MAX))
+				{
+					return;
+				}
+				compact(dict);
+			}
+			else if (!rehash(dict, dict->table.n_alloc, dict->table.probing))
+			{
+				return;
+			}
+		}
+		else if (!safe_mul(NULL, dict->table.n_alloc, 2))
 		{
 			dict->err = CERR_OVERFLOW;
 			return;
 		}
-		if (!grow(dict, dict->n_alloc * 2))
+		else if (!grow(dict, dict->table.n_alloc * 2))
 		{
 			return;
 		}
 	}
 
-	hash = get_hash(key, group);
-	slot = find(dict, hash, DELETED);
+	/* the entry array or key arena is full and mostly made of erased items, compacting them makes room */
 
-	switch (slot->state)
+	if (dict->old.n_alloc == 0
+	 && ((dict->n_entries == dict->n_entries_alloc && dict->n_entries - n > n)
+	  || (dict->keys
+	   && dict->n_chars + key->length > dict->n_chars_alloc
+	   && dict->n_chars_dead > dict->n_chars / 2)))
 	{
-		case DELETED:
-			if ((slot_2 = find(dict, hash, UNUSED)) && slot_2->state == ACTIVE)
-			{
-				slot_2->state = DELETED;
-				dict->n--;
-			}
-			/* fallthrough */
+		compact(dict);
+	}
+
+	if (!entry_reserve(dict, 1))
+	{
+		return;
+	}
+
+	if ((dict->keys && !key_reserve(dict, key->length)) || (dict->links && !chain_reserve(dict, 1)))
+	{
+		dict->err = CERR_MEMORY;
+		return;
+	}
 
-		case UNUSED:
-			slot->hash  = hash;
-			slot->group = group;
-			slot->state = ACTIVE;
-			dict->n++;
-			/* fallthrough */
+	/* a cuckoo table that found no room for the key is grown once before giving up on it */
 
-		case ACTIVE:
-			slot->value = value;
-			break;
+	e = entry_add(dict, key, value, ref);
+
+	if (!insert(dict, &dict->table, e)
+	 && (!grow(dict, dict->table.n_alloc * 2) || !insert(dict, &dict->table, e)))
+	{
+		entry_erase(dict, e);
+		dict->err = CERR_OVERFLOW;
+	}
+	else if (dict->bloom)
+	{
+		cbloom_add(dict->bloom, key->hash);
 	}
 }
 
-/************************************************************************************************************/
-/* STATIC ***************************************************************************************************/
-/************************************************************************************************************/
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-static struct slot *
-find(const cdict *dict, uint64_t hash, enum state state_cutoff)
+static size_t
+value_get(const cdict *dict, size_t e)
 {
-	struct slot *slot;
-	uint64_t i0;
-	uint64_t i;
+	/* payloads have no single size_t to give */
 
-	i0   = hash % dict->n_alloc;
-	i    = i0;
-	slot = dict->slots + i;
+	return dict->value_size ? 0 : field_get(dict, dict->values, e);
+}
 
-	while (state_cutoff < slot->state && slot->hash != hash)
-	{
-		if (++i >= dict->n_alloc)
-		{
-			i = 0;
-		}
-		if (i == i0)
-		{
-			return NULL;
-		}
-		slot = dict->slots + i;
-	}
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+value_move(const cdict *dict, size_t to, size_t from)
+{
+	size_t width = VALUE_WIDTH(dict);
 
-	return slot;
+	memmove((char*)dict->values + to * width, (const char*)dict->values + from * width, width);
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-static uint64_t
-get_hash(const char *str, size_t group)
+static void
+value_set(const cdict *dict, size_t e, size_t value, const void *ref)
 {
-	uint64_t h = HASH_OFFSET;
+	size_t width = VALUE_WIDTH(dict);
 
-	for (size_t i = 0; i < sizeof(group); i++)
+	/* payloads written without a reference get zeroed */
+
+	if (ref)
 	{
-		h = (h ^ (group & (0xFF << i))) * HASH_PRIME;
+		memcpy((char*)dict->values + e * width, ref, width);
 	}
-
-	for (size_t i = 0; str[i] != '\0'; i++)
+	else if (dict->value_size)
 	{
-		h = (h ^ str[i]) * HASH_PRIME;
+		memset((char*)dict->values + e * width, 0, width);
+	}
+	else
+	{
+		field_set(dict, dict->values, e, value);
 	}
-
-	return h;
 }
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
 
-static bool
-grow(cdict *dict, size_t n)
+static cdict *
+write_begin(cdict *dict)
 {
-	struct slot *tmp;
-	struct slot *tmp_2;
-	size_t n_2;
+	struct readers *readers = dict->readers;
 
-	if (n <= dict->n_alloc)
-	{
-		return true;
-	}
+	/* modifications go to the copy out of the front first, see write_next() */
 
-	if (!safe_mul(NULL, n, sizeof(struct slot)))
+	if (!readers)
 	{
-		dict->err = CERR_OVERFLOW;
-		return false;
+		return dict;
 	}
 
-	if (!(tmp = calloc(n, sizeof(struct slot))))
+	readers->replay = false;
+
+	return atomic_load_explicit(&readers->front, memory_order_relaxed) == dict ? readers->twin : dict;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static cdict *
+write_next(cdict *dict, cdict *done)
+{
+	struct readers *readers = dict->readers;
+	cdict *other;
+
+	if (!readers)
 	{
-		dict->err = CERR_MEMORY;
-		return false;
+		return NULL;
 	}
 
-	tmp_2 = dict->slots;
-	n_2   = dict->n_alloc;
+	other = done == dict ? readers->twin : dict;
 
-	dict->n_alloc = n;
-	dict->slots   = tmp;
+	/* the modified copy is put in front, and the modification is replayed on the other one once its */
+	/* readers left. it may fail on only one of them, like allocations, in which case both get the   */
+	/* error and cdict_repair() copies the dictionary into its twin again                            */
 
-	for (size_t i = 0; i < n_2; i++)
+	if (!readers->replay)
 	{
-		if (tmp_2[i].state == ACTIVE)
-		{
-			*find(dict, tmp_2[i].hash, UNUSED) = tmp_2[i];
-		}
+		readers->replay = true;
+		readers_switch(readers, done);
+		return other;
 	}
 
-	free(tmp_2);
+	if (done->err && !other->err)
+	{
+		readers_switch(readers, done);
+		other->err     = done->err;
+		readers->split = true;
+	}
+	else if (other->err && !done->err)
+	{
+		done->err      = other->err;
+		readers->split = true;
+	}
 
-	return true;
+	return NULL;
 }
@@ -0,0 +1,269 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hash.h"
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME  1099511628211ULL
+
+#define WY_0 0x2d358dccaa6c78a5ULL
+#define WY_1 0x8bb84b93962eacc9ULL
+#define WY_2 0x4b33a62ed433d4a3ULL
+#define WY_3 0x4d5a2da51de1aa47ULL
+
+#define GOLDEN 0x9e3779b97f4a7c15ULL
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static uint64_t entropy (void);
+static void     mum     (uint64_t *, uint64_t *);
+static uint64_t read_3  (const char *, size_t);
+static uint64_t read_4  (const char *);
+static uint64_t read_8  (const char *);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static atomic_uint_fast64_t seed_state = 0;
+
+/************************************************************************************************************/
+/* PRIVATE **************************************************************************************************/
+/************************************************************************************************************/
+
+uint64_t
+hash_fnv1a(const char *str, size_t length, size_t group, uint64_t seed)
+{
+	uint64_t h = FNV_OFFSET ^ seed;
+
+	for (size_t i = 0; i < sizeof(group); i++)
+	{
+		h = (h ^ ((group >> (i * 8)) & 0xFF)) * FNV_PRIME;
+	}
+
+	for (size_t i = 0; i < length; i++)
+	{
+		h = (h ^ (unsigned char)str[i]) * FNV_PRIME;
+	}
+
+	return h;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+uint64_t
+hash_mix(uint64_t a, uint64_t b)
+{
+	mum(&a, &b);
+
+	return a ^ b;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+uint64_t
+hash_seed(void)
+{
+	uint_fast64_t s = 0;
+	uint64_t z;
+
+	if (atomic_load(&seed_state) == 0)
+	{
+		atomic_compare_exchange_strong(&seed_state, &s, entropy() | 1);
+	}
+
+	/* splitmix64 */
+
+	z = atomic_fetch_add(&seed_state, GOLDEN) + GOLDEN;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+	return z ^ (z >> 31);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+uint64_t
+hash_wy(const char *str, size_t length, size_t group, uint64_t seed)
+{
+	uint64_t a;
+	uint64_t b;
+	uint64_t s_1;
+	uint64_t s_2;
+	size_t i;
+
+	/* wyhash, the group gets folded into the seed */
+
+	seed ^= hash_mix(seed ^ WY_0, group ^ WY_1);
+
+	if (length <= 16)
+	{
+		if (length >= 4)
+		{
+			a = (read_4(str) << 32) | read_4(str + ((length >> 3) << 2));
+			b = (read_4(str + length - 4) << 32) | read_4(str + length - 4 - ((length >> 3) << 2));
+		}
+		else if (length > 0)
+		{
+			a = read_3(str, length);
+			b = 0;
+		}
+		else
+		{
+			a = 0;
+			b = 0;
+		}
+	}
+	else
+	{
+		i = length;
+		if (i >= 48)
+		{
+			s_1 = seed;
+			s_2 = seed;
+			do
+			{
+				seed = hash_mix(read_8(str)      ^ WY_1, read_8(str + 8)  ^ seed);
+				s_1  = hash_mix(read_8(str + 16) ^ WY_2, read_8(str + 24) ^ s_1);
+				s_2  = hash_mix(read_8(str + 32) ^ WY_3, read_8(str + 40) ^ s_2);
+				str += 48;
+				i   -= 48;
+			}
+			while (i >= 48);
+			seed ^= s_1 ^ s_2;
+		}
+		for (; i > 16; i -= 16, str += 16)
+		{
+			seed = hash_mix(read_8(str) ^ WY_1, read_8(str + 8) ^ seed);
+		}
+		a = read_8(str + i - 16);
+		b = read_8(str + i - 8);
+	}
+
+	a ^= WY_1;
+	b ^= seed;
+	mum(&a, &b);
+
+	return hash_mix(a ^ WY_0 ^ length, b ^ WY_1);
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static uint64_t
+entropy(void)
+{
+	struct timespec t;
+	uint64_t e = 0;
+	int fd;
+
+	if ((fd = open("/dev/urandom", O_RDONLY)) >= 0)
+	{
+		if (read(fd, &e, sizeof(e)) != sizeof(e))
+		{
+			e = 0;
+		}
+		close(fd);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return e ^ hash_mix((uint64_t)t.tv_sec ^ WY_2, (uint64_t)t.tv_nsec ^ (uintptr_t)&t);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+mum(uint64_t *a, uint64_t *b)
+{
+#if defined(__SIZEOF_INT128__)
+	__extension__ typedef unsigned __int128 uint128_t;
+
+	uint128_t r = (uint128_t)*a * *b;
+
+	*a = (uint64_t)r;
+	*b = (uint64_t)(r >> 64);
+#else
+	uint64_t ha = *a >> 32;
+	uint64_t hb = *b >> 32;
+	uint64_t la = (uint32_t)*a;
+	uint64_t lb = (uint32_t)*b;
+	uint64_t rh = ha * hb;
+	uint64_t rm_0 = ha * lb;
+	uint64_t rm_1 = hb * la;
+	uint64_t rl = la * lb;
+	uint64_t t = rl + (rm_0 << 32);
+	uint64_t c = t < rl;
+	uint64_t lo = t + (rm_1 << 32);
+
+	c  += lo < t;
+	*a  = lo;
+	*b  = rh + (rm_0 >> 32) + (rm_1 >> 32) + c;
+#endif
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static uint64_t
+read_3(const char *str, size_t length)
+{
+	const unsigned char *p = (const unsigned char*)str;
+
+	return ((uint64_t)p[0] << 16) | ((uint64_t)p[length >> 1] << 8) | p[length - 1];
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static uint64_t
+read_4(const char *str)
+{
+	uint32_t v;
+
+	memcpy(&v, str, sizeof(v));
+
+	return v;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static uint64_t
+read_8(const char *str)
+{
+	uint64_t v;
+
+	memcpy(&v, str, sizeof(v));
+
+	return v;
+}
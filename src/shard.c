@@ -0,0 +1,406 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#include <cassette/cobj.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define CACHE_LINE 64
+#define PARTS_MAX  4096
+#define TAG_BITS   7
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/* each part sits on its own cache lines so that threads locking neighbouring parts do not contend */
+
+struct part
+{
+	_Alignas(CACHE_LINE) pthread_mutex_t lock;
+	cdict *dict;
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct cshard
+{
+	struct part *parts;
+	size_t n;
+	unsigned int shift;
+	enum cerr err;
+};
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static struct part *owner (const cshard *, uint64_t) CSHARD_NONNULL(1) CSHARD_PURE;
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+cshard cshard_placeholder_instance =
+{
+	.parts = NULL,
+	.n     = 0,
+	.shift = 0,
+	.err   = CERR_INVALID,
+};
+
+/************************************************************************************************************/
+/* PUBLIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+void
+cshard_clear(cshard *shard)
+{
+	for (size_t i = 0; i < shard->n; i++)
+	{
+		pthread_mutex_lock(&shard->parts[i].lock);
+		cdict_clear(shard->parts[i].dict);
+		pthread_mutex_unlock(&shard->parts[i].lock);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cshard_clear_group(cshard *shard, size_t group)
+{
+	for (size_t i = 0; i < shard->n; i++)
+	{
+		pthread_mutex_lock(&shard->parts[i].lock);
+		cdict_clear_group(shard->parts[i].dict, group);
+		pthread_mutex_unlock(&shard->parts[i].lock);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cshard *
+cshard_create(size_t shards_number)
+{
+	return cshard_create_with_flags(shards_number, 0);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+cshard *
+cshard_create_with_flags(size_t shards_number, unsigned int flags)
+{
+	cshard *shard;
+	uint64_t seed;
+	size_t n    = 1;
+	size_t bits = 0;
+
+	if (shards_number == 0 || shards_number > PARTS_MAX)
+	{
+		return CSHARD_PLACEHOLDER;
+	}
+
+	while (n < shards_number)
+	{
+		n *= 2;
+		bits++;
+	}
+
+	if (!(shard = calloc(1, sizeof(cshard)))
+	 || !(shard->parts = aligned_alloc(CACHE_LINE, n * sizeof(struct part))))
+	{
+		free(shard);
+		return CSHARD_PLACEHOLDER;
+	}
+
+	shard->n     = 0;
+	shard->shift = 64 - TAG_BITS - bits;
+	shard->err   = CERR_NONE;
+
+	/* all parts hash keys the same way so that a key can be hashed once before picking its part */
+
+	seed = hash_seed();
+
+	for (size_t i = 0; i < n; i++)
+	{
+		if (pthread_mutex_init(&shard->parts[i].lock, NULL) != 0)
+		{
+			cshard_destroy(shard);
+			return CSHARD_PLACEHOLDER;
+		}
+
+		shard->parts[i].dict = cdict_create_with_flags(flags);
+		shard->n = i + 1;
+
+		cdict_set_hash(shard->parts[i].dict, CDICT_HASH_WY, seed);
+
+		if (cdict_error(shard->parts[i].dict))
+		{
+			cshard_destroy(shard);
+			return CSHARD_PLACEHOLDER;
+		}
+	}
+
+	return shard;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cshard_destroy(cshard *shard)
+{
+	if (shard == CSHARD_PLACEHOLDER)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < shard->n; i++)
+	{
+		pthread_mutex_destroy(&shard->parts[i].lock);
+		cdict_destroy(shard->parts[i].dict);
+	}
+
+	free(shard->parts);
+	free(shard);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cshard_erase(cshard *shard, const char *key, size_t group)
+{
+	cshard_erase_n(shard, key, strlen(key), group);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cshard_erase_hashed(cshard *shard, struct cdict_key key)
+{
+	struct part *part;
+
+	if (shard->err)
+	{
+		return;
+	}
+
+	part = owner(shard, key.hash);
+
+	pthread_mutex_lock(&part->lock);
+	cdict_erase_hashed(part->dict, key);
+	pthread_mutex_unlock(&part->lock);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cshard_erase_n(cshard *shard, const char *key, size_t length, size_t group)
+{
+	cshard_erase_hashed(shard, cshard_hash(shard, key, length, group));
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+enum cerr
+cshard_error(const cshard *shard)
+{
+	enum cerr err = shard->err;
+
+	for (size_t i = 0; i < shard->n && !err; i++)
+	{
+		pthread_mutex_lock(&shard->parts[i].lock);
+		err = cdict_error(shard->parts[i].dict);
+		pthread_mutex_unlock(&shard->parts[i].lock);
+	}
+
+	return err;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cshard_find(const cshard *shard, const char *key, size_t group, size_t *value)
+{
+	return cshard_find_n(shard, key, strlen(key), group, value);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cshard_find_hashed(const cshard *shard, struct cdict_key key, size_t *value)
+{
+	struct part *part;
+	bool found;
+
+	if (shard->err)
+	{
+		return false;
+	}
+
+	part = owner(shard, key.hash);
+
+	pthread_mutex_lock(&part->lock);
+	found = cdict_find_hashed(part->dict, key, value);
+	pthread_mutex_unlock(&part->lock);
+
+	return found;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+cshard_find_n(const cshard *shard, const char *key, size_t length, size_t group, size_t *value)
+{
+	return cshard_find_hashed(shard, cshard_hash(shard, key, length, group), value);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+cshard_group_length(const cshard *shard, size_t group)
+{
+	size_t n = 0;
+
+	for (size_t i = 0; i < shard->n; i++)
+	{
+		pthread_mutex_lock(&shard->parts[i].lock);
+		n += cdict_group_length(shard->parts[i].dict, group);
+		pthread_mutex_unlock(&shard->parts[i].lock);
+	}
+
+	return n;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct cdict_key
+cshard_hash(const cshard *shard, const char *key, size_t length, size_t group)
+{
+	/* the hash function and seed of a part never change after creation, reading them needs no lock */
+
+	return cdict_hash(shard->n > 0 ? shard->parts[0].dict : CDICT_PLACEHOLDER, key, length, group);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+cshard_load(const cshard *shard)
+{
+	size_t n = 0;
+
+	for (size_t i = 0; i < shard->n; i++)
+	{
+		pthread_mutex_lock(&shard->parts[i].lock);
+		n += cdict_load(shard->parts[i].dict);
+		pthread_mutex_unlock(&shard->parts[i].lock);
+	}
+
+	return n;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cshard_prealloc(cshard *shard, size_t slots_number)
+{
+	for (size_t i = 0; i < shard->n; i++)
+	{
+		pthread_mutex_lock(&shard->parts[i].lock);
+		cdict_prealloc(shard->parts[i].dict, slots_number / shard->n + (slots_number % shard->n > 0));
+		pthread_mutex_unlock(&shard->parts[i].lock);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cshard_repair(cshard *shard)
+{
+	for (size_t i = 0; i < shard->n; i++)
+	{
+		pthread_mutex_lock(&shard->parts[i].lock);
+		cdict_repair(shard->parts[i].dict);
+		pthread_mutex_unlock(&shard->parts[i].lock);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+cshard_shards(const cshard *shard)
+{
+	return shard->n;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cshard_write(cshard *shard, const char *key, size_t group, size_t value)
+{
+	cshard_write_n(shard, key, strlen(key), group, value);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cshard_write_hashed(cshard *shard, struct cdict_key key, size_t value)
+{
+	struct part *part;
+
+	if (shard->err)
+	{
+		return;
+	}
+
+	part = owner(shard, key.hash);
+
+	pthread_mutex_lock(&part->lock);
+	cdict_write_hashed(part->dict, key, value);
+	pthread_mutex_unlock(&part->lock);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+cshard_write_n(cshard *shard, const char *key, size_t length, size_t group, size_t value)
+{
+	cshard_write_hashed(shard, cshard_hash(shard, key, length, group), value);
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static struct part *
+owner(const cshard *shard, uint64_t hash)
+{
+	/* the high bits are left to the control tags of the part, and the low ones to its home slots */
+
+	return shard->parts + (hash >> shard->shift & (shard->n - 1));
+}
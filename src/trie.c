@@ -0,0 +1,1439 @@
+/**
+ * Copyright © 2024 Fraawlen <fraawlen@posteo.net>
+ *
+ * This file is part of the Cassette Objects (COBJ) library.
+ *
+ * This library is free software; you can redistribute it and/or modify it either under the terms of the GNU
+ * Lesser General Public License as published by the Free Software Foundation; either version 2.1 of the
+ * License or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ * See the LGPL for the specific language governing rights and limitations.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this program. If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#include <cassette/cobj.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+#define GROUP_BYTES 8
+#define KEY_MAX     (UINT32_MAX - GROUP_BYTES)
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+enum kind
+{
+	KIND_LEAF,
+	KIND_4,
+	KIND_16,
+	KIND_48,
+	KIND_256,
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* common head of leaves and inner nodes */
+
+struct node
+{
+	uint8_t kind;
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct leaf
+{
+	struct node node;
+	size_t group;
+	size_t value;
+	size_t length;
+	char key[];
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* inner nodes are followed in memory by n_prefix bytes that all keys below them share before branching */
+/* the end slot holds the leaf whose key stops right after that prefix, if any                          */
+
+struct inner
+{
+	struct node node;
+	uint16_t n;
+	uint32_t n_prefix;
+	struct node *end;
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* keys of nodes of 4 and 16 children are kept sorted */
+
+struct node_4
+{
+	struct inner inner;
+	uint8_t keys[4];
+	struct node *children[4];
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct node_16
+{
+	struct inner inner;
+	uint8_t keys[16];
+	struct node *children[16];
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* index holds the child's slot + 1 for each byte, or 0 */
+
+struct node_48
+{
+	struct inner inner;
+	uint8_t index[256];
+	struct node *children[48];
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct node_256
+{
+	struct inner inner;
+	struct node *children[256];
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+/* key as laid out along the tree, 8 big endian group bytes then the key bytes */
+
+struct path
+{
+	uint8_t head[GROUP_BYTES];
+	const char *key;
+	size_t n;
+	size_t group;
+	size_t length;
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+struct ctrie
+{
+	struct node *root;
+	size_t n;
+	enum cerr err;
+};
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+static void          add          (struct inner *, uint8_t, struct node *)                               CTRIE_NONNULL(1, 3);
+static uint8_t       at           (const struct path *, size_t)                                          CTRIE_NONNULL(1) CTRIE_PURE;
+static struct node **child        (struct inner *, uint8_t)                                              CTRIE_NONNULL(1);
+static int           compare      (const struct leaf *, const struct path *)                             CTRIE_NONNULL(1, 2) CTRIE_PURE;
+static void          destroy_tree (struct node *);
+static void          entry_set    (struct cdict_entry *, const struct leaf *)                            CTRIE_NONNULL(1, 2);
+static void          erase        (ctrie *, const struct path *)                                         CTRIE_NONNULL(1, 2);
+static struct leaf  *find         (const ctrie *, const struct path *)                                   CTRIE_NONNULL(1, 2) CTRIE_PURE;
+static size_t        find_16      (const struct node_16 *, uint8_t)                                      CTRIE_NONNULL(1) CTRIE_PURE;
+static unsigned      first_bit    (unsigned)                                                             CTRIE_PURE;
+static struct inner *inner_create (enum kind, size_t);
+static void          insert       (ctrie *, const struct path *, size_t)                                 CTRIE_NONNULL(1, 2);
+static struct leaf  *leaf_create  (const struct path *, size_t)                                          CTRIE_NONNULL(1);
+static struct leaf  *lower        (const ctrie *, const struct path *, bool)                             CTRIE_NONNULL(1, 2) CTRIE_PURE;
+static struct leaf  *minimum      (struct node *)                                                        CTRIE_NONNULL(1) CTRIE_PURE;
+static struct node  *next         (struct inner *, unsigned, uint8_t *)                                  CTRIE_NONNULL(1, 3);
+static size_t        next_16      (const struct node_16 *, unsigned)                                     CTRIE_NONNULL(1) CTRIE_PURE;
+static unsigned      next_48      (const struct node_48 *, unsigned)                                     CTRIE_NONNULL(1) CTRIE_PURE;
+static void          normalize    (struct node **)                                                       CTRIE_NONNULL(1);
+static struct path   path_make    (const char *, size_t, size_t)                                         CTRIE_NONNULL(1) CTRIE_PURE;
+static void          place        (struct inner *, const struct path *, size_t, struct node *)           CTRIE_NONNULL(1, 2, 4);
+static uint8_t      *prefix       (struct inner *)                                                       CTRIE_NONNULL(1) CTRIE_PURE;
+static void          remove_child (struct inner *, uint8_t)                                              CTRIE_NONNULL(1);
+static struct inner *resize       (struct inner *, enum kind)                                            CTRIE_NONNULL(1);
+static void          split_leaf   (ctrie *, struct node **, const struct path *, size_t, size_t)         CTRIE_NONNULL(1, 2, 3);
+static void          split_prefix (ctrie *, struct node **, const struct path *, size_t, size_t, size_t) CTRIE_NONNULL(1, 2, 3);
+static struct leaf  *step         (const ctrie *, const struct path *, const struct cdict_entry *)       CTRIE_NONNULL(1, 2, 3);
+
+/************************************************************************************************************/
+/************************************************************************************************************/
+/************************************************************************************************************/
+
+/* node sizes without their prefix, how many children they fit, and how few they keep before shrinking */
+
+static const size_t sizes[] =
+{
+	[KIND_4]   = sizeof(struct node_4),
+	[KIND_16]  = sizeof(struct node_16),
+	[KIND_48]  = sizeof(struct node_48),
+	[KIND_256] = sizeof(struct node_256),
+};
+
+static const size_t caps[] =
+{
+	[KIND_4]   = 4,
+	[KIND_16]  = 16,
+	[KIND_48]  = 48,
+	[KIND_256] = 256,
+};
+
+static const size_t floors[] =
+{
+	[KIND_4]   = 0,
+	[KIND_16]  = 3,
+	[KIND_48]  = 12,
+	[KIND_256] = 37,
+};
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+ctrie ctrie_placeholder_instance =
+{
+	.root = NULL,
+	.n    = 0,
+	.err  = CERR_INVALID,
+};
+
+/************************************************************************************************************/
+/* PUBLIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+void
+ctrie_clear(ctrie *trie)
+{
+	if (trie->err)
+	{
+		return;
+	}
+
+	destroy_tree(trie->root);
+
+	trie->root = NULL;
+	trie->n    = 0;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+ctrie *
+ctrie_clone(const ctrie *trie)
+{
+	struct cdict_entry entry;
+	ctrie *trie_new;
+
+	if (trie->err)
+	{
+		return CTRIE_PLACEHOLDER;
+	}
+
+	trie_new = ctrie_create();
+
+	CTRIE_FOR_EACH(trie, entry)
+	{
+		ctrie_write_n(trie_new, entry.key, entry.length, entry.group, entry.value);
+	}
+
+	if (trie_new->err)
+	{
+		ctrie_destroy(trie_new);
+		return CTRIE_PLACEHOLDER;
+	}
+
+	return trie_new;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+ctrie *
+ctrie_create(void)
+{
+	ctrie *trie;
+
+	if (!(trie = malloc(sizeof(ctrie))))
+	{
+		return CTRIE_PLACEHOLDER;
+	}
+
+	trie->root = NULL;
+	trie->n    = 0;
+	trie->err  = CERR_NONE;
+
+	return trie;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+ctrie_destroy(ctrie *trie)
+{
+	if (trie == CTRIE_PLACEHOLDER)
+	{
+		return;
+	}
+
+	destroy_tree(trie->root);
+	free(trie);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+ctrie_erase(ctrie *trie, const char *key, size_t group)
+{
+	ctrie_erase_n(trie, key, strlen(key), group);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+ctrie_erase_n(ctrie *trie, const char *key, size_t length, size_t group)
+{
+	struct path p;
+
+	if (trie->err || length > KEY_MAX)
+	{
+		return;
+	}
+
+	p = path_make(key, length, group);
+
+	erase(trie, &p);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+enum cerr
+ctrie_error(const ctrie *trie)
+{
+	return trie->err;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+ctrie_find(const ctrie *trie, const char *key, size_t group, size_t *value)
+{
+	return ctrie_find_n(trie, key, strlen(key), group, value);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+ctrie_find_n(const ctrie *trie, const char *key, size_t length, size_t group, size_t *value)
+{
+	struct path p;
+	struct leaf *l;
+
+	if (trie->err || length > KEY_MAX)
+	{
+		return false;
+	}
+
+	p = path_make(key, length, group);
+
+	if (!(l = find(trie, &p)))
+	{
+		return false;
+	}
+
+	if (value)
+	{
+		*value = l->value;
+	}
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+size_t
+ctrie_load(const ctrie *trie)
+{
+	if (trie->err)
+	{
+		return 0;
+	}
+
+	return trie->n;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+ctrie_next(const ctrie *trie, struct cdict_entry *entry)
+{
+	struct path p;
+	struct leaf *l;
+
+	if (trie->err)
+	{
+		return false;
+	}
+
+	p = path_make("", 0, 0);
+
+	if (!(l = step(trie, &p, entry)))
+	{
+		return false;
+	}
+
+	entry_set(entry, l);
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+ctrie_next_in_prefix(const ctrie *trie, const char *prefix, size_t group, struct cdict_entry *entry)
+{
+	return ctrie_next_in_prefix_n(trie, prefix, strlen(prefix), group, entry);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+ctrie_next_in_prefix_n(const ctrie *trie, const char *prefix, size_t length, size_t group,
+                       struct cdict_entry *entry)
+{
+	struct path p;
+	struct leaf *l;
+
+	if (trie->err || length > KEY_MAX)
+	{
+		return false;
+	}
+
+	p = path_make(prefix, length, group);
+
+	/* keys sharing the prefix all come right after it, so the first one that does not ends the scan */
+
+	if (!(l = step(trie, &p, entry))
+	 || l->group != group
+	 || l->length < length
+	 || memcmp(l->key, prefix, length))
+	{
+		return false;
+	}
+
+	entry_set(entry, l);
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+bool
+ctrie_next_in_range(const ctrie *trie, const char *from, const char *to, size_t group,
+                    struct cdict_entry *entry)
+{
+	struct path p;
+	struct path p_to;
+	struct leaf *l;
+
+	if (trie->err)
+	{
+		return false;
+	}
+
+	p = from ? path_make(from, strlen(from), group) : path_make("", 0, group);
+
+	if (!(l = step(trie, &p, entry)) || l->group != group)
+	{
+		return false;
+	}
+
+	if (to)
+	{
+		p_to = path_make(to, strlen(to), group);
+		if (compare(l, &p_to) >= 0)
+		{
+			return false;
+		}
+	}
+
+	entry_set(entry, l);
+
+	return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+ctrie_repair(ctrie *trie)
+{
+	if (trie->err != CERR_INVALID)
+	{
+		trie->err = CERR_NONE;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+ctrie_write(ctrie *trie, const char *key, size_t group, size_t value)
+{
+	ctrie_write_n(trie, key, strlen(key), group, value);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+void
+ctrie_write_n(ctrie *trie, const char *key, size_t length, size_t group, size_t value)
+{
+	struct path p;
+
+	if (trie->err)
+	{
+		return;
+	}
+
+	if (length > KEY_MAX)
+	{
+		trie->err = CERR_OVERFLOW;
+		return;
+	}
+
+	p = path_make(key, length, group);
+
+	insert(trie, &p, value);
+}
+
+/************************************************************************************************************/
+/* STATIC ***************************************************************************************************/
+/************************************************************************************************************/
+
+static void
+add(struct inner *in, uint8_t byte, struct node *node)
+{
+	struct node_4 *n4;
+	struct node_16 *n16;
+	struct node_48 *n48;
+	size_t i;
+
+	switch (in->node.kind)
+	{
+		case KIND_4:
+			n4 = (struct node_4*)in;
+			for (i = in->n; i > 0 && n4->keys[i - 1] > byte; i--)
+			{
+				n4->keys[i]     = n4->keys[i - 1];
+				n4->children[i] = n4->children[i - 1];
+			}
+			n4->keys[i]     = byte;
+			n4->children[i] = node;
+			break;
+
+		case KIND_16:
+			n16 = (struct node_16*)in;
+			for (i = in->n; i > 0 && n16->keys[i - 1] > byte; i--)
+			{
+				n16->keys[i]     = n16->keys[i - 1];
+				n16->children[i] = n16->children[i - 1];
+			}
+			n16->keys[i]     = byte;
+			n16->children[i] = node;
+			break;
+
+		case KIND_48:
+			n48 = (struct node_48*)in;
+			for (i = 0; n48->children[i]; i++);
+			n48->children[i] = node;
+			n48->index[byte] = (uint8_t)(i + 1);
+			break;
+
+		case KIND_256:
+			((struct node_256*)in)->children[byte] = node;
+			break;
+	}
+
+	in->n++;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static uint8_t
+at(const struct path *p, size_t i)
+{
+	return i < GROUP_BYTES ? p->head[i] : (uint8_t)p->key[i - GROUP_BYTES];
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static struct node **
+child(struct inner *in, uint8_t byte)
+{
+	struct node_4 *n4;
+	struct node_16 *n16;
+	struct node_48 *n48;
+	struct node_256 *n256;
+	size_t i;
+
+	switch (in->node.kind)
+	{
+		case KIND_4:
+			n4 = (struct node_4*)in;
+			for (i = 0; i < in->n && n4->keys[i] != byte; i++);
+			return i < in->n ? n4->children + i : NULL;
+
+		case KIND_16:
+			n16 = (struct node_16*)in;
+			i   = find_16(n16, byte);
+			return i < in->n ? n16->children + i : NULL;
+
+		case KIND_48:
+			n48 = (struct node_48*)in;
+			return n48->index[byte] ? n48->children + n48->index[byte] - 1 : NULL;
+
+		case KIND_256:
+			n256 = (struct node_256*)in;
+			return n256->children[byte] ? n256->children + byte : NULL;
+	}
+
+	return NULL;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static int
+compare(const struct leaf *l, const struct path *p)
+{
+	int c;
+
+	if (l->group != p->group)
+	{
+		return l->group < p->group ? -1 : 1;
+	}
+
+	if ((c = memcmp(l->key, p->key, l->length < p->n ? l->length : p->n)))
+	{
+		return c;
+	}
+
+	return (l->length > p->n) - (l->length < p->n);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+destroy_tree(struct node *node)
+{
+	struct inner *in;
+	struct inner *up;
+	struct node *c;
+	uint8_t byte;
+
+	if (!node || node->kind == KIND_LEAF)
+	{
+		free(node);
+		return;
+	}
+
+	/* the tree is torn down without recursion, so that deep ones cannot overflow the stack. once the */
+	/* end leaf of a node is freed, its end slot links back to the parent node until it gets emptied  */
+
+	in = (struct inner*)node;
+	free(in->end);
+	in->end = NULL;
+
+	while (in)
+	{
+		if (!(c = next(in, 0, &byte)))
+		{
+			up = (struct inner*)in->end;
+			free(in);
+			in = up;
+			continue;
+		}
+
+		remove_child(in, byte);
+
+		if (c->kind == KIND_LEAF)
+		{
+			free(c);
+			continue;
+		}
+
+		up = in;
+		in = (struct inner*)c;
+		free(in->end);
+		in->end = &up->node;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+entry_set(struct cdict_entry *entry, const struct leaf *l)
+{
+	entry->key    = l->key;
+	entry->length = l->length;
+	entry->group  = l->group;
+	entry->value  = l->value;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+erase(ctrie *trie, const struct path *p)
+{
+	struct node **ref = &trie->root;
+	struct node **slot;
+	struct inner *in;
+	size_t depth = 0;
+	uint8_t byte;
+
+	if (!*ref)
+	{
+		return;
+	}
+
+	if ((*ref)->kind == KIND_LEAF)
+	{
+		if (!compare((struct leaf*)*ref, p))
+		{
+			free(*ref);
+			*ref = NULL;
+			trie->n--;
+		}
+		return;
+	}
+
+	/* only the parent of the erased leaf loses a child, so only that node needs to be normalized */
+
+	while (true)
+	{
+		in = (struct inner*)*ref;
+		if (in->n_prefix > p->length - depth)
+		{
+			return;
+		}
+
+		depth += in->n_prefix;
+		if (depth == p->length)
+		{
+			if (!in->end || compare((struct leaf*)in->end, p))
+			{
+				return;
+			}
+			free(in->end);
+			in->end = NULL;
+			break;
+		}
+
+		byte = at(p, depth++);
+		if (!(slot = child(in, byte)))
+		{
+			return;
+		}
+
+		if ((*slot)->kind == KIND_LEAF)
+		{
+			if (compare((struct leaf*)*slot, p))
+			{
+				return;
+			}
+			free(*slot);
+			remove_child(in, byte);
+			break;
+		}
+
+		ref = slot;
+	}
+
+	trie->n--;
+
+	normalize(ref);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static struct leaf *
+find(const ctrie *trie, const struct path *p)
+{
+	struct node *node = trie->root;
+	struct node **slot;
+	struct inner *in;
+	size_t depth = 0;
+
+	/* prefixes are skipped without being compared, the leaf reached at the end gets checked whole instead */
+
+	while (node && node->kind != KIND_LEAF)
+	{
+		in = (struct inner*)node;
+		if (in->n_prefix > p->length - depth)
+		{
+			return NULL;
+		}
+
+		depth += in->n_prefix;
+		if (depth == p->length)
+		{
+			node = in->end;
+			break;
+		}
+
+		slot = child(in, at(p, depth++));
+		node = slot ? *slot : NULL;
+	}
+
+	return node && !compare((struct leaf*)node, p) ? (struct leaf*)node : NULL;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+find_16(const struct node_16 *n16, uint8_t byte)
+{
+#if defined(__SSE2__)
+	__m128i keys = _mm_loadu_si128((const __m128i*)n16->keys);
+	__m128i eq   = _mm_cmpeq_epi8(keys, _mm_set1_epi8((char)byte));
+	unsigned mask = (unsigned)_mm_movemask_epi8(eq) & ((1u << n16->inner.n) - 1);
+
+	return mask ? first_bit(mask) : 16;
+#else
+	size_t i = 0;
+
+	for (; i < n16->inner.n && n16->keys[i] != byte; i++);
+
+	return i < n16->inner.n ? i : 16;
+#endif
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static unsigned
+first_bit(unsigned mask)
+{
+#if __GNUC__ > 4
+	return (unsigned)__builtin_ctz(mask);
+#else
+	unsigned i = 0;
+
+	for (; !(mask & 1); mask >>= 1)
+	{
+		i++;
+	}
+
+	return i;
+#endif
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static struct inner *
+inner_create(enum kind kind, size_t n_prefix)
+{
+	struct inner *in;
+
+	if (!(in = calloc(1, sizes[kind] + n_prefix)))
+	{
+		return NULL;
+	}
+
+	in->node.kind = (uint8_t)kind;
+	in->n_prefix  = (uint32_t)n_prefix;
+
+	return in;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+insert(ctrie *trie, const struct path *p, size_t value)
+{
+	struct node **ref = &trie->root;
+	struct node **slot;
+	struct inner *in;
+	struct inner *in_big;
+	struct leaf *l;
+	uint8_t *pre;
+	size_t depth = 0;
+	size_t m;
+
+	while (*ref && (*ref)->kind != KIND_LEAF)
+	{
+		in  = (struct inner*)*ref;
+		pre = prefix(in);
+		for (m = 0; m < in->n_prefix && depth + m < p->length && pre[m] == at(p, depth + m); m++);
+		if (m < in->n_prefix)
+		{
+			split_prefix(trie, ref, p, depth, m, value);
+			return;
+		}
+
+		depth += in->n_prefix;
+		if (depth == p->length)
+		{
+			ref = &in->end;
+			break;
+		}
+
+		if ((slot = child(in, at(p, depth))))
+		{
+			ref = slot;
+			depth++;
+			continue;
+		}
+
+		/* the key branches off here */
+
+		if (in->n == caps[in->node.kind])
+		{
+			if (!(in_big = resize(in, in->node.kind + 1)))
+			{
+				trie->err = CERR_MEMORY;
+				return;
+			}
+			*ref = &in_big->node;
+			in   = in_big;
+		}
+
+		if (!(l = leaf_create(p, value)))
+		{
+			trie->err = CERR_MEMORY;
+			return;
+		}
+
+		add(in, at(p, depth), &l->node);
+		trie->n++;
+		return;
+	}
+
+	if (*ref)
+	{
+		l = (struct leaf*)*ref;
+		if (!compare(l, p))
+		{
+			l->value = value;
+		}
+		else
+		{
+			split_leaf(trie, ref, p, depth, value);
+		}
+		return;
+	}
+
+	if (!(l = leaf_create(p, value)))
+	{
+		trie->err = CERR_MEMORY;
+		return;
+	}
+
+	*ref = &l->node;
+	trie->n++;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static struct leaf *
+leaf_create(const struct path *p, size_t value)
+{
+	struct leaf *l;
+
+	if (!(l = malloc(sizeof(struct leaf) + p->n + 1)))
+	{
+		return NULL;
+	}
+
+	memcpy(l->key, p->key, p->n);
+
+	l->node.kind = KIND_LEAF;
+	l->key[p->n] = '\0';
+	l->group     = p->group;
+	l->value     = value;
+	l->length    = p->n;
+
+	return l;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static struct leaf *
+lower(const ctrie *trie, const struct path *p, bool strict)
+{
+	struct node *node = trie->root;
+	struct node *after = NULL;
+	struct node **slot;
+	struct node *c;
+	struct inner *in;
+	struct leaf *l;
+	uint8_t *pre;
+	uint8_t byte;
+	size_t depth = 0;
+	size_t m;
+
+	/* finds the first leaf past the key, or at it when not strict. on the way down, the smallest sibling */
+	/* that follows the taken branch is remembered, the deepest one being where to resume if the descent */
+	/* runs out of matching leaves                                                                       */
+
+	while (node)
+	{
+		if (node->kind == KIND_LEAF)
+		{
+			l = (struct leaf*)node;
+			if (compare(l, p) > 0 || (!strict && !compare(l, p)))
+			{
+				return l;
+			}
+			break;
+		}
+
+		in  = (struct inner*)node;
+		pre = prefix(in);
+		for (m = 0; m < in->n_prefix && depth + m < p->length && pre[m] == at(p, depth + m); m++);
+		if (m < in->n_prefix)
+		{
+			if (depth + m == p->length || pre[m] > at(p, depth + m))
+			{
+				return minimum(node);
+			}
+			break;
+		}
+
+		depth += in->n_prefix;
+		if (depth == p->length)
+		{
+			if (in->end && !strict)
+			{
+				return (struct leaf*)in->end;
+			}
+			node = next(in, 0, &byte);
+			return node ? minimum(node) : (after ? minimum(after) : NULL);
+		}
+
+		byte = at(p, depth++);
+		slot = child(in, byte);
+		if ((c = next(in, byte + 1u, &byte)))
+		{
+			after = c;
+		}
+
+		node = slot ? *slot : NULL;
+	}
+
+	return after ? minimum(after) : NULL;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static struct leaf *
+minimum(struct node *node)
+{
+	struct inner *in;
+	uint8_t byte;
+
+	while (node->kind != KIND_LEAF)
+	{
+		in   = (struct inner*)node;
+		node = in->end ? in->end : next(in, 0, &byte);
+	}
+
+	return (struct leaf*)node;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static struct node *
+next(struct inner *in, unsigned from, uint8_t *byte)
+{
+	struct node_4 *n4;
+	struct node_16 *n16;
+	struct node_48 *n48;
+	struct node_256 *n256;
+	size_t i;
+
+	if (from > UINT8_MAX)
+	{
+		return NULL;
+	}
+
+	switch (in->node.kind)
+	{
+		case KIND_4:
+			n4 = (struct node_4*)in;
+			for (i = 0; i < in->n && n4->keys[i] < from; i++);
+			if (i < in->n)
+			{
+				*byte = n4->keys[i];
+				return n4->children[i];
+			}
+			break;
+
+		case KIND_16:
+			n16 = (struct node_16*)in;
+			if ((i = next_16(n16, from)) < in->n)
+			{
+				*byte = n16->keys[i];
+				return n16->children[i];
+			}
+			break;
+
+		case KIND_48:
+			n48 = (struct node_48*)in;
+			if ((i = next_48(n48, from)) <= UINT8_MAX)
+			{
+				*byte = (uint8_t)i;
+				return n48->children[n48->index[i] - 1];
+			}
+			break;
+
+		case KIND_256:
+			n256 = (struct node_256*)in;
+			for (i = from; i <= UINT8_MAX && !n256->children[i]; i++);
+			if (i <= UINT8_MAX)
+			{
+				*byte = (uint8_t)i;
+				return n256->children[i];
+			}
+			break;
+	}
+
+	return NULL;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static size_t
+next_16(const struct node_16 *n16, unsigned from)
+{
+#if defined(__SSE2__)
+	__m128i keys = _mm_loadu_si128((const __m128i*)n16->keys);
+	__m128i ge   = _mm_cmpeq_epi8(_mm_max_epu8(keys, _mm_set1_epi8((char)from)), keys);
+	unsigned mask = (unsigned)_mm_movemask_epi8(ge) & ((1u << n16->inner.n) - 1);
+
+	return mask ? first_bit(mask) : 16;
+#else
+	size_t i = 0;
+
+	for (; i < n16->inner.n && n16->keys[i] < from; i++);
+
+	return i < n16->inner.n ? i : 16;
+#endif
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static unsigned
+next_48(const struct node_48 *n48, unsigned from)
+{
+	unsigned i = from;
+
+#if defined(__SSE2__)
+	unsigned mask;
+
+	for (; i % 16 && i <= UINT8_MAX; i++)
+	{
+		if (n48->index[i])
+		{
+			return i;
+		}
+	}
+
+	for (; i <= UINT8_MAX; i += 16)
+	{
+		mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(n48->index + i)),
+		                                                  _mm_setzero_si128()));
+		if ((mask ^= 0xFFFF))
+		{
+			return i + first_bit(mask);
+		}
+	}
+#else
+	for (; i <= UINT8_MAX && !n48->index[i]; i++);
+#endif
+
+	return i;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+normalize(struct node **ref)
+{
+	struct inner *in = (struct inner*)*ref;
+	struct inner *in_c;
+	struct inner *in_small;
+	struct node *c;
+	uint8_t *pre;
+	uint8_t byte;
+	size_t n_prefix;
+
+	/* a node left without children is replaced by its end leaf */
+
+	if (in->n == 0)
+	{
+		*ref = in->end;
+		free(in);
+		return;
+	}
+
+	/* a node left with a single child and no end leaf is merged into that child, whose prefix grows by */
+	/* the node's prefix and the byte that led to it. leaves hold their whole key and need no merging  */
+
+	if (in->n == 1 && !in->end)
+	{
+		c = next(in, 0, &byte);
+		if (c->kind == KIND_LEAF)
+		{
+			*ref = c;
+			free(in);
+			return;
+		}
+
+		in_c     = (struct inner*)c;
+		n_prefix = in->n_prefix + 1 + in_c->n_prefix;
+		if (!(in_c = realloc(in_c, sizes[in_c->node.kind] + n_prefix)))
+		{
+			return;
+		}
+
+		pre = prefix(in_c);
+		memmove(pre + in->n_prefix + 1, pre, in_c->n_prefix);
+		memcpy(pre, prefix(in), in->n_prefix);
+		pre[in->n_prefix] = byte;
+
+		in_c->n_prefix = (uint32_t)n_prefix;
+		*ref = &in_c->node;
+		free(in);
+		return;
+	}
+
+	if (in->n <= floors[in->node.kind] && (in_small = resize(in, in->node.kind - 1)))
+	{
+		*ref = &in_small->node;
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static struct path
+path_make(const char *key, size_t length, size_t group)
+{
+	struct path p;
+
+	for (size_t i = 0; i < GROUP_BYTES; i++)
+	{
+		p.head[i] = (uint8_t)((uint64_t)group >> (8 * (GROUP_BYTES - 1 - i)));
+	}
+
+	p.key    = key;
+	p.n      = length;
+	p.group  = group;
+	p.length = length + GROUP_BYTES;
+
+	return p;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+place(struct inner *in, const struct path *p, size_t depth, struct node *node)
+{
+	if (depth == p->length)
+	{
+		in->end = node;
+	}
+	else
+	{
+		add(in, at(p, depth), node);
+	}
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static uint8_t *
+prefix(struct inner *in)
+{
+	return (uint8_t*)in + sizes[in->node.kind];
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+remove_child(struct inner *in, uint8_t byte)
+{
+	struct node_4 *n4;
+	struct node_16 *n16;
+	struct node_48 *n48;
+	size_t i;
+
+	switch (in->node.kind)
+	{
+		case KIND_4:
+			n4 = (struct node_4*)in;
+			for (i = 0; n4->keys[i] != byte; i++);
+			for (; i + 1 < in->n; i++)
+			{
+				n4->keys[i]     = n4->keys[i + 1];
+				n4->children[i] = n4->children[i + 1];
+			}
+			break;
+
+		case KIND_16:
+			n16 = (struct node_16*)in;
+			for (i = find_16(n16, byte); i + 1 < in->n; i++)
+			{
+				n16->keys[i]     = n16->keys[i + 1];
+				n16->children[i] = n16->children[i + 1];
+			}
+			break;
+
+		case KIND_48:
+			n48 = (struct node_48*)in;
+			n48->children[n48->index[byte] - 1] = NULL;
+			n48->index[byte] = 0;
+			break;
+
+		case KIND_256:
+			((struct node_256*)in)->children[byte] = NULL;
+			break;
+	}
+
+	in->n--;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static struct inner *
+resize(struct inner *in, enum kind kind)
+{
+	struct inner *in_new;
+	struct node *c;
+	uint8_t byte;
+
+	if (!(in_new = inner_create(kind, in->n_prefix)))
+	{
+		return NULL;
+	}
+
+	memcpy(prefix(in_new), prefix(in), in->n_prefix);
+
+	in_new->end = in->end;
+
+	for (c = next(in, 0, &byte); c; c = next(in, byte + 1u, &byte))
+	{
+		add(in_new, byte, c);
+	}
+
+	free(in);
+
+	return in_new;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+split_leaf(ctrie *trie, struct node **ref, const struct path *p, size_t depth, size_t value)
+{
+	struct leaf *l = (struct leaf*)*ref;
+	struct leaf *l_new;
+	struct inner *in;
+	struct path p_old;
+	size_t n;
+	size_t m;
+
+	/* both keys share m more bytes, that become the prefix of a new node holding both leaves */
+
+	p_old = path_make(l->key, l->length, l->group);
+
+	n = p->length < p_old.length ? p->length : p_old.length;
+
+	for (m = 0; depth + m < n && at(p, depth + m) == at(&p_old, depth + m); m++);
+
+	in    = inner_create(KIND_4, m);
+	l_new = leaf_create(p, value);
+	if (!in || !l_new)
+	{
+		free(in);
+		free(l_new);
+		trie->err = CERR_MEMORY;
+		return;
+	}
+
+	for (size_t i = 0; i < m; i++)
+	{
+		prefix(in)[i] = at(p, depth + i);
+	}
+
+	place(in, &p_old, depth + m, &l->node);
+	place(in, p,      depth + m, &l_new->node);
+
+	*ref = &in->node;
+	trie->n++;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static void
+split_prefix(ctrie *trie, struct node **ref, const struct path *p, size_t depth, size_t m, size_t value)
+{
+	struct inner *in = (struct inner*)*ref;
+	struct inner *in_top;
+	struct leaf *l;
+	uint8_t *pre = prefix(in);
+	uint8_t byte;
+
+	/* the key diverges after m bytes of the node's prefix, a new node takes these bytes and holds both */
+	/* the new leaf and the old node, which keeps the rest of its prefix past the diverging byte        */
+
+	in_top = inner_create(KIND_4, m);
+	l      = leaf_create(p, value);
+	if (!in_top || !l)
+	{
+		free(in_top);
+		free(l);
+		trie->err = CERR_MEMORY;
+		return;
+	}
+
+	memcpy(prefix(in_top), pre, m);
+
+	byte = pre[m];
+	memmove(pre, pre + m + 1, in->n_prefix - m - 1);
+	in->n_prefix -= (uint32_t)(m + 1);
+
+	add(in_top, byte, &in->node);
+	place(in_top, p, depth + m, &l->node);
+
+	*ref = &in_top->node;
+	trie->n++;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
+
+static struct leaf *
+step(const ctrie *trie, const struct path *start, const struct cdict_entry *entry)
+{
+	struct path p;
+
+	/* iterations resume right after the last returned key */
+
+	if (!entry->key)
+	{
+		return lower(trie, start, false);
+	}
+
+	p = path_make(entry->key, entry->length, entry->group);
+
+	return lower(trie, &p, true);
+}